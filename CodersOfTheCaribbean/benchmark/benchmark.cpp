@@ -0,0 +1,243 @@
+/*
+ * benchmark.cpp
+ *
+ * Pathfinding benchmark for Coders of the Caribbean: replays turns recorded by the referee (--record) and runs every
+ * searcher over the same start/destination pairs, then reports nodes, speed, path cost and latency.
+ *
+ * build: g++ -std=c++14 -O2 -o benchmark benchmark.cpp
+ * usage: benchmark [--deadline MS] [--searcher NAME] <recording>...
+ * e.g.:  benchmark corpus/match_1*.txt
+ *
+ * The pairs of a turn are each of our ships to each barrel, then to the point CommandFollow aims at for each enemy ship.
+ * Distance fields are computed before the clock starts, so only the search itself is measured. The recorded ships
+ * followed the commands of the bot that played the match, so astar-plans only reuses a plan when its move matched.
+ */
+
+#include <fstream>
+
+#define COTC_BENCHMARK
+#include "../source/main.cpp"
+
+//=============================================================
+// STRUCTS
+//=============================================================
+
+typedef int (*PathSearch)(const Ship& ship, DistanceFieldCache* distanceFields, const DangerMap* dangerMap,
+		const OffsetCoord destination, double deadline, int& move, SearchStats* stats);
+
+struct Searcher
+{
+	string name;
+	PathSearch search;
+};
+
+// plans are kept per recording, from one turn to the next
+PathPlanner PATH_PLANNER;
+
+int FindPathWithPlans(const Ship& ship, DistanceFieldCache* distanceFields, const DangerMap* dangerMap, const OffsetCoord destination,
+		double deadline, int& move, SearchStats* stats)
+{
+	return PATH_PLANNER.FindPath(ship, distanceFields, dangerMap, destination, deadline, move, stats);
+}
+
+// every replacement of FindPath gets an entry here so it runs on the same corpus
+const Searcher SEARCHERS[] =
+{
+{ "astar", FindPath },
+{ "astar-plans", FindPathWithPlans } };
+
+struct SearcherResults
+{
+	int queries = 0;
+	int fullPaths = 0;
+	int partialPaths = 0;
+	int failures = 0;
+	long long expandedNodes = 0;
+	long long generatedNodes = 0;
+	long long pathCost = 0; // over full paths
+	long long pathLength = 0; // over full paths
+	double time = 0; // ms
+	vector<double> latencies;
+};
+
+//=============================================================
+// FUNCTIONS
+//=============================================================
+
+double Percentile(const vector<double>& sorted, double fraction)
+{
+	if (sorted.empty())
+		return 0;
+
+	return sorted[min(sorted.size() - 1, (size_t) (fraction * sorted.size()))];
+}
+
+/**
+ * Runs one searcher on one start/destination pair.
+ */
+void RunQuery(const Searcher& searcher, const Ship& ship, DistanceFieldCache& distanceFields, const DangerMap& dangerMap,
+		const OffsetCoord& destination, double deadlineTime, SearcherResults& results)
+{
+	SearchStats stats;
+	int move;
+
+	double begin = timing::Now();
+	int result = searcher.search(ship, &distanceFields, &dangerMap, destination, begin + deadlineTime, move, &stats);
+	double latency = timing::Now() - begin;
+
+	results.queries++;
+	results.time += latency;
+	results.latencies.push_back(latency);
+	results.expandedNodes += stats.expandedNodes;
+	results.generatedNodes += stats.generatedNodes;
+
+	if (result == 1)
+	{
+		results.fullPaths++;
+		results.pathCost += stats.pathCost;
+		results.pathLength += stats.pathLength;
+	}
+	else if (result == 0)
+		results.partialPaths++;
+	else
+		results.failures++;
+}
+
+/**
+ * Replays one recording turn by turn, with the same game state updates as the bot.
+ */
+void RunRecording(const string& fileName, const vector<const Searcher*>& searchers, double deadlineTime,
+		vector<SearcherResults>& results)
+{
+	ifstream input(fileName);
+
+	if (!input.is_open())
+	{
+		cout << "cannot open " << fileName << endl;
+		return;
+	}
+
+	vector<Ship> myShips;
+	vector<Barrel> barrels;
+	vector<OffsetCoord> mines;
+	EntityTracker tracker;
+	DistanceFieldCache distanceFields;
+	DangerMap dangerMap;
+	vector<string> objectMap = vector<string>(MAP_WIDTH * MAP_HEIGHT, "e");
+	PATH_PLANNER = PathPlanner();
+
+	int myShipCount, entityCount;
+
+	while (input >> myShipCount >> entityCount)
+	{
+		input.ignore();
+		TURN_ARENA.Reset();
+		ReadTurn(input, entityCount, myShips, tracker, barrels, mines, objectMap);
+
+		distanceFields.Reset(&objectMap);
+		dangerMap.Build(tracker, mines, myShips);
+		PATH_PLANNER.BeginTurn();
+
+		vector<OffsetCoord> destinations;
+
+		for (unsigned int i = 0; i < barrels.size(); i++)
+			destinations.push_back(barrels[i].offsetPos);
+
+		const vector<Ship>& enemyShips = tracker.GetEnemyShips();
+
+		for (unsigned int i = 0; i < enemyShips.size(); i++)
+		{
+			const Ship& enemy = enemyShips[i];
+			OffsetCoord target = CubeToOffset(enemy.GetCenterPosCube() + DIRECTIONS[enemy.GetRotation()] * (enemy.GetSpeed() * 2));
+			target.col = max(0, min(target.col, MAP_WIDTH - 2));
+			target.row = max(0, min(target.row, MAP_HEIGHT - 2));
+			destinations.push_back(target);
+		}
+
+		for (unsigned int d = 0; d < destinations.size(); d++)
+			distanceFields.Get(destinations[d]);
+
+		for (unsigned int s = 0; s < myShips.size(); s++)
+		{
+			for (unsigned int d = 0; d < destinations.size(); d++)
+			{
+				for (unsigned int i = 0; i < searchers.size(); i++)
+					RunQuery(*searchers[i], myShips[s], distanceFields, dangerMap, destinations[d], deadlineTime, results[i]);
+			}
+		}
+
+		for (unsigned int i = 0; i < myShips.size(); i++)
+			myShips[i].SetUpdated(false);
+
+		barrels.clear();
+		mines.clear();
+		fill(objectMap.begin(), objectMap.end(), "e");
+	}
+}
+
+void Report(const Searcher& searcher, SearcherResults& results)
+{
+	sort(results.latencies.begin(), results.latencies.end());
+
+	double queries = max(1, results.queries);
+	double fullPaths = max(1, results.fullPaths);
+
+	cout << searcher.name << endl;
+	cout << "  queries: " << results.queries << "  full: " << results.fullPaths << "  partial: " << results.partialPaths << "  failed: "
+			<< results.failures << endl;
+	cout << "  nodes: expanded=" << results.expandedNodes / queries << " generated=" << results.generatedNodes / queries
+			<< " per query, " << (long long) (results.expandedNodes / max(1e-3, results.time / 1000)) << " expanded/s" << endl;
+	cout << "  full paths: cost=" << results.pathCost / fullPaths << " length=" << results.pathLength / fullPaths << endl;
+	cout << "  latency ms: p50=" << Percentile(results.latencies, 0.5) << " p90=" << Percentile(results.latencies, 0.9) << " p99="
+			<< Percentile(results.latencies, 0.99) << " max=" << (results.latencies.empty() ? 0 : results.latencies.back()) << " total="
+			<< results.time << endl;
+}
+
+//=============================================================
+// MAIN
+//=============================================================
+int main(int argc, char** argv)
+{
+	double deadlineTime = TURN_TIME;
+	string searcherName;
+	vector<string> recordings;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string argument = argv[i];
+
+		if (argument == "--deadline" && i + 1 < argc)
+			deadlineTime = atof(argv[++i]);
+		else if (argument == "--searcher" && i + 1 < argc)
+			searcherName = argv[++i];
+		else
+			recordings.push_back(argument);
+	}
+
+	vector<const Searcher*> searchers;
+
+	for (unsigned int i = 0; i < sizeof(SEARCHERS) / sizeof(SEARCHERS[0]); i++)
+	{
+		if (searcherName.empty() || SEARCHERS[i].name == searcherName)
+			searchers.push_back(&SEARCHERS[i]);
+	}
+
+	if (recordings.empty() || searchers.empty())
+	{
+		cerr << "usage: benchmark [--deadline MS] [--searcher NAME] <recording>..." << endl;
+		return 1;
+	}
+
+	// the searchers log every call
+	cerr.rdbuf(nullptr);
+
+	vector<SearcherResults> results(searchers.size());
+
+	for (unsigned int i = 0; i < recordings.size(); i++)
+		RunRecording(recordings[i], searchers, deadlineTime, results);
+
+	for (unsigned int i = 0; i < searchers.size(); i++)
+		Report(*searchers[i], results[i]);
+
+	return 0;
+}
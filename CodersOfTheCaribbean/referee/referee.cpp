@@ -0,0 +1,1296 @@
+/*
+ * referee.cpp
+ *
+ * Local referee for Coders of the Caribbean: plays seeded matches between two bot binaries over the stdin/stdout protocol,
+ * several matches at a time, and reports the results of the first bot.
+ *
+ * build: g++ -std=c++14 -O2 -pthread -o referee referee.cpp
+ * usage: referee [--games N] [--seed S] [--threads T] [--lenient] [--verbose] [--record DIR] <bot1> <bot2>
+ *
+ * Every match uses its own seed (S + match index) for the map generation, and the same seed is given to both bots as their
+ * first argument so their random choices are repeatable. Bots swap sides every other match.
+ *
+ * With --record, the input sent to the first bot is saved as DIR/match_<seed>.txt, which the benchmark replays.
+ *
+ * The bot built with -DCOTC_COMMAND_CHAIN plays with its command chain alone, without the fleet search; playing it against
+ * the default build keeps the chain checked: referee --games 20 bot bot_chain
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+//=============================================================
+// CONSTANTS
+//=============================================================
+
+const int MAP_WIDTH = 23;
+const int MAP_HEIGHT = 21;
+
+const int COOLDOWN_CANNON = 2;
+const int COOLDOWN_MINE = 5;
+const int INITIAL_SHIP_HEALTH = 100;
+const int MAX_SHIP_HEALTH = 100;
+const int MAX_SHIP_SPEED = 2;
+const int MIN_SHIPS = 1;
+const int MAX_SHIPS = 3;
+const int MIN_MINES = 5;
+const int MAX_MINES = 10;
+const int MIN_RUM_BARRELS = 10;
+const int MAX_RUM_BARRELS = 26;
+const int MIN_RUM_BARREL_VALUE = 10;
+const int MAX_RUM_BARREL_VALUE = 20;
+const int REWARD_RUM_BARREL_VALUE = 30;
+const int MINE_VISIBILITY_RANGE = 5;
+const int FIRE_DISTANCE_MAX = 10;
+const int LOW_DAMAGE = 25;
+const int HIGH_DAMAGE = 50;
+const int MINE_DAMAGE = 25;
+const int NEAR_MINE_DAMAGE = 10;
+const int MAX_TURNS = 200;
+
+const double FIRST_TURN_TIMEOUT = 1000; // ms
+const double TURN_TIMEOUT = 50; // ms
+
+double Now()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000. + now.tv_nsec / 1000000.;
+}
+
+//#############################################################
+//#############################################################
+// NAMESPACE RULES
+//#############################################################
+//#############################################################
+
+namespace rules
+{
+
+//=============================================================
+// STRUCTS
+//=============================================================
+
+// neighbours in offset coordinates (odd rows are shifted right), indexed by orientation
+const int DIRECTIONS_EVEN[6][2] =
+{
+{ 1, 0 },
+{ 0, -1 },
+{ -1, -1 },
+{ -1, 0 },
+{ -1, 1 },
+{ 0, 1 } };
+const int DIRECTIONS_ODD[6][2] =
+{
+{ 1, 0 },
+{ 1, -1 },
+{ 0, -1 },
+{ -1, 0 },
+{ 0, 1 },
+{ 1, 1 } };
+
+struct Coord
+{
+	int x = -1, y = -1;
+
+	Coord()
+	{
+	}
+
+	Coord(int x, int y) :
+			x(x), y(y)
+	{
+	}
+
+	bool operator==(const Coord& o) const
+	{
+		return x == o.x && y == o.y;
+	}
+
+	bool operator!=(const Coord& o) const
+	{
+		return !(*this == o);
+	}
+
+	Coord Neighbour(int orientation) const
+	{
+		const int (*directions)[2] = (y % 2 == 1) ? DIRECTIONS_ODD : DIRECTIONS_EVEN;
+		return Coord(x + directions[orientation][0], y + directions[orientation][1]);
+	}
+
+	bool IsInsideMap() const
+	{
+		return x >= 0 && x < MAP_WIDTH && y >= 0 && y < MAP_HEIGHT;
+	}
+
+	int DistanceTo(const Coord& o) const
+	{
+		int ax = x - (y - (y & 1)) / 2, az = y, ay = -ax - az;
+		int bx = o.x - (o.y - (o.y & 1)) / 2, bz = o.y, by = -bx - bz;
+		return (abs(ax - bx) + abs(ay - by) + abs(az - bz)) / 2;
+	}
+
+	/**
+	 * Direction of the target as a continuous orientation in [0, 6), used by the MOVE autopilot.
+	 */
+	double Angle(const Coord& target) const
+	{
+		double dy = (target.y - y) * sqrt(3) / 2;
+		double dx = target.x - x + ((y - target.y) & 1) * (0.5 - (y & 1));
+		double angle = -atan2(dy, dx) * 3 / M_PI;
+
+		if (angle < 0)
+			angle += 6;
+		else if (angle >= 6)
+			angle -= 6;
+
+		return angle;
+	}
+};
+
+enum Action
+{
+	ACTION_NONE, ACTION_FASTER, ACTION_SLOWER, ACTION_PORT, ACTION_STARBOARD, ACTION_FIRE, ACTION_MINE
+};
+
+struct Ship
+{
+	int id;
+	int owner;
+	Coord position;
+	int orientation = 0;
+	int speed = 0;
+	int health = INITIAL_SHIP_HEALTH;
+	int initialHealth = INITIAL_SHIP_HEALTH;
+	int cannonCooldown = 0;
+	int mineCooldown = 0;
+
+	Action action = ACTION_NONE;
+	Coord target;
+
+	int newOrientation = 0;
+	Coord newPosition;
+	Coord newBow;
+	Coord newStern;
+
+	Ship(int id, int x, int y, int orientation, int owner) :
+			id(id), owner(owner), position(x, y), orientation(orientation)
+	{
+	}
+
+	Coord Bow() const
+	{
+		return position.Neighbour(orientation);
+	}
+	Coord Stern() const
+	{
+		return position.Neighbour((orientation + 3) % 6);
+	}
+	Coord NewBow() const
+	{
+		return position.Neighbour(newOrientation);
+	}
+	Coord NewStern() const
+	{
+		return position.Neighbour((newOrientation + 3) % 6);
+	}
+	bool At(const Coord& coord) const
+	{
+		return coord == position || coord == Bow() || coord == Stern();
+	}
+	bool NewBowIntersect(const Ship& other) const
+	{
+		return newBow == other.newBow || newBow == other.newPosition || newBow == other.newStern;
+	}
+	bool NewPositionsIntersect(const Ship& other) const
+	{
+		bool sternCollision = newStern == other.newBow || newStern == other.newPosition || newStern == other.newStern;
+		bool centerCollision = newPosition == other.newBow || newPosition == other.newPosition || newPosition == other.newStern;
+		return NewBowIntersect(other) || sternCollision || centerCollision;
+	}
+	void Damage(int amount)
+	{
+		health = max(0, health - amount);
+	}
+	void Heal(int amount)
+	{
+		health = min(MAX_SHIP_HEALTH, health + amount);
+	}
+	/**
+	 * The autopilot of the MOVE command, as the official referee implements it.
+	 */
+	void MoveTo(const Coord& targetPosition)
+	{
+		Coord currentPosition = position;
+		action = ACTION_NONE;
+
+		if (currentPosition == targetPosition)
+		{
+			action = ACTION_SLOWER;
+			return;
+		}
+
+		auto angleDiff = [](double a, double b)
+		{	return min(abs(a - b), 6 - abs(a - b));};
+		auto portAngle = [this](double target)
+		{	return min(abs((orientation + 1) - target), abs((orientation - 5) - target));};
+		auto starboardAngle = [this](double target)
+		{	return min(abs((orientation + 5) - target), abs((orientation - 1) - target));};
+
+		Coord center(MAP_WIDTH / 2, MAP_HEIGHT / 2);
+
+		if (speed == 2)
+		{
+			action = ACTION_SLOWER;
+		}
+		else if (speed == 1)
+		{
+			// suppose we have moved first
+			currentPosition = currentPosition.Neighbour(orientation);
+
+			if (!currentPosition.IsInsideMap())
+			{
+				action = ACTION_SLOWER;
+				return;
+			}
+
+			if (currentPosition == targetPosition)
+				return;
+
+			double targetAngle = currentPosition.Angle(targetPosition);
+			double angleStraight = angleDiff(orientation, targetAngle);
+			double anglePort = portAngle(targetAngle);
+			double angleStarboard = starboardAngle(targetAngle);
+			double centerAngle = currentPosition.Angle(center);
+			double anglePortCenter = portAngle(centerAngle);
+			double angleStarboardCenter = starboardAngle(centerAngle);
+
+			// next to the target with a bad angle: slow down, then rotate
+			if (currentPosition.DistanceTo(targetPosition) == 1 && angleStraight > 1.5)
+			{
+				action = ACTION_SLOWER;
+				return;
+			}
+
+			int distanceMin = -1;
+
+			Coord nextPosition = currentPosition.Neighbour(orientation);
+			if (nextPosition.IsInsideMap())
+			{
+				distanceMin = nextPosition.DistanceTo(targetPosition);
+				action = ACTION_NONE;
+			}
+
+			nextPosition = currentPosition.Neighbour((orientation + 1) % 6);
+			if (nextPosition.IsInsideMap())
+			{
+				int distance = nextPosition.DistanceTo(targetPosition);
+
+				if (distanceMin < 0 || distance < distanceMin || (distance == distanceMin && anglePort < angleStraight - 0.5))
+				{
+					distanceMin = distance;
+					action = ACTION_PORT;
+				}
+			}
+
+			nextPosition = currentPosition.Neighbour((orientation + 5) % 6);
+			if (nextPosition.IsInsideMap())
+			{
+				int distance = nextPosition.DistanceTo(targetPosition);
+
+				if (distanceMin < 0 || distance < distanceMin
+						|| (distance == distanceMin && angleStarboard < anglePort - 0.5 && action == ACTION_PORT)
+						|| (distance == distanceMin && angleStarboard < angleStraight - 0.5 && action == ACTION_NONE)
+						|| (distance == distanceMin && action == ACTION_PORT && angleStarboard == anglePort
+								&& angleStarboardCenter < anglePortCenter)
+						|| (distance == distanceMin && action == ACTION_PORT && angleStarboard == anglePort
+								&& angleStarboardCenter == anglePortCenter && (orientation == 1 || orientation == 4)))
+				{
+					distanceMin = distance;
+					action = ACTION_STARBOARD;
+				}
+			}
+		}
+		else
+		{
+			// rotate towards the target
+			double targetAngle = currentPosition.Angle(targetPosition);
+			double angleStraight = angleDiff(orientation, targetAngle);
+			double anglePort = portAngle(targetAngle);
+			double angleStarboard = starboardAngle(targetAngle);
+			double centerAngle = currentPosition.Angle(center);
+			double anglePortCenter = portAngle(centerAngle);
+			double angleStarboardCenter = starboardAngle(centerAngle);
+
+			Coord forwardPosition = currentPosition.Neighbour(orientation);
+
+			if (anglePort <= angleStarboard)
+				action = ACTION_PORT;
+
+			if (angleStarboard < anglePort || (angleStarboard == anglePort && angleStarboardCenter < anglePortCenter)
+					|| (angleStarboard == anglePort && angleStarboardCenter == anglePortCenter && (orientation == 1 || orientation == 4)))
+				action = ACTION_STARBOARD;
+
+			if (forwardPosition.IsInsideMap() && angleStraight <= anglePort && angleStraight <= angleStarboard)
+				action = ACTION_FASTER;
+		}
+	}
+};
+
+struct Mine
+{
+	int id;
+	Coord position;
+};
+
+struct Cannonball
+{
+	int id;
+	Coord position;
+	int ownerEntityId;
+	int remainingTurns;
+};
+
+struct Barrel
+{
+	int id;
+	Coord position;
+	int health;
+};
+
+/**
+ * One match with the official rules. The turn update follows the order of the official referee: cannonballs fly, rum is
+ * drunk, actions are applied, ships move one cell at a time, rotate, then cannonballs and mines explode.
+ */
+class Game
+{
+	// VARIABLES
+private:
+	mt19937 _random;
+	int _nextEntityId = 0;
+	int _turn = 0;
+
+	vector<Ship> _ships;
+	vector<Mine> _mines;
+	vector<Cannonball> _cannonballs;
+	vector<Barrel> _barrels;
+	vector<Coord> _cannonballExplosions;
+
+	// CONSTRUCTORS
+public:
+	Game(unsigned int seed) :
+			_random(seed)
+	{
+		int shipsPerPlayer = RandomInt(MIN_SHIPS, MAX_SHIPS);
+
+		for (int i = 0; i < shipsPerPlayer; i++)
+		{
+			int xMin = 1 + i * MAP_WIDTH / shipsPerPlayer;
+			int xMax = (i + 1) * MAP_WIDTH / shipsPerPlayer - 2;
+
+			int y = 1 + RandomInt(0, MAP_HEIGHT / 2 - 3);
+			int x = RandomInt(xMin, xMax);
+			int orientation = RandomInt(0, 5);
+
+			_ships.emplace_back(_nextEntityId++, x, y, orientation, 0);
+			_ships.emplace_back(_nextEntityId++, x, MAP_HEIGHT - 1 - y, (6 - orientation) % 6, 1);
+		}
+
+		int mineCount = RandomInt(MIN_MINES, MAX_MINES - 1);
+		while ((int) _mines.size() < mineCount)
+		{
+			Coord position(1 + RandomInt(0, MAP_WIDTH - 3), 1 + RandomInt(0, MAP_HEIGHT / 2 - 1));
+
+			if (IsFree(position, true, true, false))
+			{
+				if (position.y != MAP_HEIGHT - 1 - position.y)
+					_mines.push_back(Mine { _nextEntityId++, Coord(position.x, MAP_HEIGHT - 1 - position.y) });
+
+				_mines.push_back(Mine { _nextEntityId++, position });
+			}
+		}
+
+		int barrelCount = RandomInt(MIN_RUM_BARRELS, MAX_RUM_BARRELS - 1);
+		while ((int) _barrels.size() < barrelCount)
+		{
+			Coord position(1 + RandomInt(0, MAP_WIDTH - 3), 1 + RandomInt(0, MAP_HEIGHT / 2 - 1));
+			int health = RandomInt(MIN_RUM_BARREL_VALUE, MAX_RUM_BARREL_VALUE);
+
+			if (IsFree(position, true, true, true))
+			{
+				if (position.y != MAP_HEIGHT - 1 - position.y)
+					_barrels.push_back(Barrel { _nextEntityId++, Coord(position.x, MAP_HEIGHT - 1 - position.y), health });
+
+				_barrels.push_back(Barrel { _nextEntityId++, position, health });
+			}
+		}
+	}
+
+	// FUNCTIONS
+private:
+	int RandomInt(int min, int max)
+	{
+		return uniform_int_distribution<int>(min, max)(_random);
+	}
+	bool IsFree(const Coord& position, bool checkShips, bool checkMines, bool checkBarrels) const
+	{
+		for (unsigned int i = 0; checkShips && i < _ships.size(); i++)
+		{
+			if (_ships[i].At(position))
+				return false;
+		}
+		for (unsigned int i = 0; checkMines && i < _mines.size(); i++)
+		{
+			if (_mines[i].position == position)
+				return false;
+		}
+		for (unsigned int i = 0; checkBarrels && i < _barrels.size(); i++)
+		{
+			if (_barrels[i].position == position)
+				return false;
+		}
+
+		return true;
+	}
+	void ExplodeMine(const Mine& mine, bool force)
+	{
+		Ship* victim = nullptr;
+
+		for (unsigned int i = 0; i < _ships.size(); i++)
+		{
+			if (_ships[i].At(mine.position))
+			{
+				_ships[i].Damage(MINE_DAMAGE);
+				victim = &_ships[i];
+			}
+		}
+
+		if (!force && victim == nullptr)
+			return;
+
+		for (unsigned int i = 0; i < _ships.size(); i++)
+		{
+			Ship& ship = _ships[i];
+
+			if (&ship != victim && (ship.Stern().DistanceTo(mine.position) <= 1 || ship.Bow().DistanceTo(mine.position) <= 1
+					|| ship.position.DistanceTo(mine.position) <= 1))
+				ship.Damage(NEAR_MINE_DAMAGE);
+		}
+	}
+	/**
+	 * Picks up the barrels under the ship and triggers the mines touched by any ship.
+	 */
+	void CheckCollisions(Ship& ship)
+	{
+		for (unsigned int i = 0; i < _barrels.size(); i++)
+		{
+			if (ship.At(_barrels[i].position))
+			{
+				ship.Heal(_barrels[i].health);
+				_barrels.erase(_barrels.begin() + i);
+				i--;
+			}
+		}
+
+		for (unsigned int i = 0; i < _mines.size(); i++)
+		{
+			bool touched = false;
+
+			for (unsigned int j = 0; j < _ships.size() && !touched; j++)
+				touched = _ships[j].At(_mines[i].position);
+
+			if (touched)
+			{
+				Mine mine = _mines[i];
+				_mines.erase(_mines.begin() + i);
+				i--;
+				ExplodeMine(mine, false);
+			}
+		}
+	}
+	void ApplyActions()
+	{
+		for (unsigned int i = 0; i < _ships.size(); i++)
+		{
+			Ship& ship = _ships[i];
+
+			if (ship.mineCooldown > 0)
+				ship.mineCooldown--;
+			if (ship.cannonCooldown > 0)
+				ship.cannonCooldown--;
+
+			ship.newOrientation = ship.orientation;
+
+			switch (ship.action)
+			{
+			case ACTION_FASTER:
+				if (ship.speed < MAX_SHIP_SPEED)
+					ship.speed++;
+				break;
+			case ACTION_SLOWER:
+				if (ship.speed > 0)
+					ship.speed--;
+				break;
+			case ACTION_PORT:
+				ship.newOrientation = (ship.orientation + 1) % 6;
+				break;
+			case ACTION_STARBOARD:
+				ship.newOrientation = (ship.orientation + 5) % 6;
+				break;
+			case ACTION_MINE:
+				if (ship.mineCooldown == 0)
+				{
+					Coord target = ship.Stern().Neighbour((ship.orientation + 3) % 6);
+
+					if (target.IsInsideMap() && IsFree(target, true, true, true))
+					{
+						ship.mineCooldown = COOLDOWN_MINE;
+						_mines.push_back(Mine { _nextEntityId++, target });
+					}
+				}
+				break;
+			case ACTION_FIRE:
+				if (ship.cannonCooldown == 0)
+				{
+					int distance = ship.Bow().DistanceTo(ship.target);
+
+					if (ship.target.IsInsideMap() && distance <= FIRE_DISTANCE_MAX)
+					{
+						int travelTime = (int) (1 + round(distance / 3.0));
+						_cannonballs.push_back(Cannonball { _nextEntityId++, ship.target, ship.id, travelTime });
+						ship.cannonCooldown = COOLDOWN_CANNON;
+					}
+				}
+				break;
+			default:
+				break;
+			}
+		}
+	}
+	void MoveShips()
+	{
+		for (int step = 1; step <= MAX_SHIP_SPEED; step++)
+		{
+			for (unsigned int i = 0; i < _ships.size(); i++)
+			{
+				Ship& ship = _ships[i];
+				ship.newPosition = ship.position;
+				ship.newBow = ship.Bow();
+				ship.newStern = ship.Stern();
+
+				if (step > ship.speed)
+					continue;
+
+				Coord newPosition = ship.position.Neighbour(ship.orientation);
+
+				if (newPosition.IsInsideMap())
+				{
+					ship.newPosition = newPosition;
+					ship.newBow = newPosition.Neighbour(ship.orientation);
+					ship.newStern = newPosition.Neighbour((ship.orientation + 3) % 6);
+				}
+				else
+				{
+					ship.speed = 0;
+				}
+			}
+
+			// ships whose bow runs into another ship stay where they are, which can cause new collisions
+			for (bool collision = true; collision;)
+			{
+				collision = false;
+				vector<int> collided;
+
+				for (unsigned int i = 0; i < _ships.size(); i++)
+				{
+					for (unsigned int j = 0; j < _ships.size(); j++)
+					{
+						if (i != j && _ships[i].newPosition != _ships[i].position && _ships[i].NewBowIntersect(_ships[j]))
+						{
+							collided.push_back(i);
+							break;
+						}
+					}
+				}
+
+				for (unsigned int c = 0; c < collided.size(); c++)
+				{
+					Ship& ship = _ships[collided[c]];
+					ship.newPosition = ship.position;
+					ship.newBow = ship.Bow();
+					ship.newStern = ship.Stern();
+					ship.speed = 0;
+					collision = true;
+				}
+			}
+
+			for (unsigned int i = 0; i < _ships.size(); i++)
+			{
+				_ships[i].position = _ships[i].newPosition;
+				CheckCollisions(_ships[i]);
+			}
+		}
+	}
+	void RotateShips()
+	{
+		for (unsigned int i = 0; i < _ships.size(); i++)
+		{
+			Ship& ship = _ships[i];
+			ship.newPosition = ship.position;
+			ship.newBow = ship.NewBow();
+			ship.newStern = ship.NewStern();
+		}
+
+		for (bool collision = true; collision;)
+		{
+			collision = false;
+			vector<int> collided;
+
+			for (unsigned int i = 0; i < _ships.size(); i++)
+			{
+				for (unsigned int j = 0; j < _ships.size(); j++)
+				{
+					if (i != j && _ships[i].newOrientation != _ships[i].orientation && _ships[i].NewPositionsIntersect(_ships[j]))
+					{
+						collided.push_back(i);
+						break;
+					}
+				}
+			}
+
+			for (unsigned int c = 0; c < collided.size(); c++)
+			{
+				Ship& ship = _ships[collided[c]];
+				ship.newOrientation = ship.orientation;
+				ship.newBow = ship.NewBow();
+				ship.newStern = ship.NewStern();
+				ship.speed = 0;
+				collision = true;
+			}
+		}
+
+		for (unsigned int i = 0; i < _ships.size(); i++)
+		{
+			_ships[i].orientation = _ships[i].newOrientation;
+			CheckCollisions(_ships[i]);
+		}
+	}
+	void ExplodeCannonballs()
+	{
+		for (unsigned int e = 0; e < _cannonballExplosions.size(); e++)
+		{
+			const Coord& position = _cannonballExplosions[e];
+			bool consumed = false;
+
+			for (unsigned int i = 0; i < _ships.size() && !consumed; i++)
+			{
+				if (position == _ships[i].Bow() || position == _ships[i].Stern())
+				{
+					_ships[i].Damage(LOW_DAMAGE);
+					consumed = true;
+				}
+				else if (position == _ships[i].position)
+				{
+					_ships[i].Damage(HIGH_DAMAGE);
+					consumed = true;
+				}
+			}
+
+			for (unsigned int i = 0; i < _mines.size() && !consumed; i++)
+			{
+				if (_mines[i].position == position)
+				{
+					Mine mine = _mines[i];
+					_mines.erase(_mines.begin() + i);
+					ExplodeMine(mine, true);
+					consumed = true;
+				}
+			}
+
+			for (unsigned int i = 0; i < _barrels.size() && !consumed; i++)
+			{
+				if (_barrels[i].position == position)
+				{
+					_barrels.erase(_barrels.begin() + i);
+					consumed = true;
+				}
+			}
+		}
+
+		_cannonballExplosions.clear();
+	}
+public:
+	int GetTurn() const
+	{
+		return _turn;
+	}
+	int GetShipCount(int player) const
+	{
+		int count = 0;
+
+		for (unsigned int i = 0; i < _ships.size(); i++)
+		{
+			if (_ships[i].owner == player)
+				count++;
+		}
+
+		return count;
+	}
+	int GetRum(int player) const
+	{
+		int rum = 0;
+
+		for (unsigned int i = 0; i < _ships.size(); i++)
+		{
+			if (_ships[i].owner == player)
+				rum += _ships[i].health;
+		}
+
+		return rum;
+	}
+	bool IsOver() const
+	{
+		return _turn >= MAX_TURNS || GetShipCount(0) == 0 || GetShipCount(1) == 0;
+	}
+	/**
+	 * The input of one turn for a player, in the official format.
+	 */
+	string GetInput(int player) const
+	{
+		vector<string> entities;
+		ostringstream line;
+
+		for (unsigned int i = 0; i < _ships.size(); i++)
+		{
+			const Ship& ship = _ships[i];
+			line.str("");
+			line << ship.id << " SHIP " << ship.position.x << " " << ship.position.y << " " << ship.orientation << " " << ship.speed << " "
+					<< ship.health << " " << (ship.owner == player ? 1 : 0);
+			entities.push_back(line.str());
+		}
+
+		for (unsigned int i = 0; i < _barrels.size(); i++)
+		{
+			line.str("");
+			line << _barrels[i].id << " BARREL " << _barrels[i].position.x << " " << _barrels[i].position.y << " " << _barrels[i].health
+					<< " 0 0 0";
+			entities.push_back(line.str());
+		}
+
+		for (unsigned int i = 0; i < _cannonballs.size(); i++)
+		{
+			line.str("");
+			line << _cannonballs[i].id << " CANNONBALL " << _cannonballs[i].position.x << " " << _cannonballs[i].position.y << " "
+					<< _cannonballs[i].ownerEntityId << " " << _cannonballs[i].remainingTurns << " 0 0";
+			entities.push_back(line.str());
+		}
+
+		for (unsigned int i = 0; i < _mines.size(); i++)
+		{
+			bool visible = false;
+
+			for (unsigned int j = 0; j < _ships.size() && !visible; j++)
+				visible = _ships[j].owner == player && _ships[j].position.DistanceTo(_mines[i].position) <= MINE_VISIBILITY_RANGE;
+
+			if (!visible)
+				continue;
+
+			line.str("");
+			line << _mines[i].id << " MINE " << _mines[i].position.x << " " << _mines[i].position.y << " 0 0 0 0";
+			entities.push_back(line.str());
+		}
+
+		ostringstream input;
+		input << GetShipCount(player) << "\n" << entities.size() << "\n";
+
+		for (unsigned int i = 0; i < entities.size(); i++)
+			input << entities[i] << "\n";
+
+		return input.str();
+	}
+	/**
+	 * Reads one command per ship of the player, in the order the ships were given.
+	 * returns false if a command is invalid
+	 */
+	bool SetActions(int player, const vector<string>& commands)
+	{
+		unsigned int commandIndex = 0;
+
+		for (unsigned int i = 0; i < _ships.size(); i++)
+		{
+			Ship& ship = _ships[i];
+
+			if (ship.owner != player)
+				continue;
+
+			if (commandIndex >= commands.size())
+				return false;
+
+			istringstream command(commands[commandIndex++]);
+			string name;
+			command >> name;
+
+			ship.action = ACTION_NONE;
+
+			if (name == "MOVE")
+			{
+				Coord target;
+				if (!(command >> target.x >> target.y))
+					return false;
+				ship.MoveTo(target);
+			}
+			else if (name == "FIRE")
+			{
+				ship.action = ACTION_FIRE;
+				if (!(command >> ship.target.x >> ship.target.y))
+					return false;
+			}
+			else if (name == "FASTER")
+				ship.action = ACTION_FASTER;
+			else if (name == "SLOWER")
+				ship.action = ACTION_SLOWER;
+			else if (name == "PORT")
+				ship.action = ACTION_PORT;
+			else if (name == "STARBOARD")
+				ship.action = ACTION_STARBOARD;
+			else if (name == "MINE")
+				ship.action = ACTION_MINE;
+			else if (name != "WAIT")
+				return false;
+		}
+
+		return true;
+	}
+	void Update()
+	{
+		for (unsigned int i = 0; i < _cannonballs.size(); i++)
+		{
+			if (_cannonballs[i].remainingTurns == 0)
+			{
+				_cannonballs.erase(_cannonballs.begin() + i);
+				i--;
+				continue;
+			}
+
+			_cannonballs[i].remainingTurns--;
+
+			if (_cannonballs[i].remainingTurns == 0)
+				_cannonballExplosions.push_back(_cannonballs[i].position);
+		}
+
+		for (unsigned int i = 0; i < _ships.size(); i++)
+		{
+			_ships[i].Damage(1);
+			_ships[i].initialHealth = _ships[i].health;
+		}
+
+		ApplyActions();
+		MoveShips();
+		RotateShips();
+		ExplodeCannonballs();
+
+		// sunk ships leave a barrel with part of their rum
+		for (unsigned int i = 0; i < _ships.size(); i++)
+		{
+			if (_ships[i].health > 0)
+				continue;
+
+			int reward = min(REWARD_RUM_BARREL_VALUE, _ships[i].initialHealth);
+
+			if (reward > 0)
+				_barrels.push_back(Barrel { _nextEntityId++, _ships[i].position, reward });
+
+			_ships.erase(_ships.begin() + i);
+			i--;
+		}
+
+		_turn++;
+	}
+};
+
+}
+using namespace rules;
+
+//#############################################################
+//#############################################################
+// NAMESPACE ARENA
+//#############################################################
+//#############################################################
+
+namespace arena
+{
+
+//=============================================================
+// STRUCTS
+//=============================================================
+
+/**
+ * A bot binary running as a child process, talking through pipes.
+ */
+class BotProcess
+{
+	// VARIABLES
+private:
+	pid_t _pid = -1;
+	int _input = -1;
+	int _output = -1;
+	string _buffer;
+
+	// CONSTRUCTORS
+public:
+	BotProcess(const BotProcess&) = delete;
+	BotProcess& operator=(const BotProcess&) = delete;
+	BotProcess(const string& command, unsigned int seed)
+	{
+		int toBot[2], fromBot[2];
+
+		if (pipe2(toBot, O_CLOEXEC) != 0)
+		{
+			cerr << "cannot start " << command << ": pipe: " << strerror(errno) << endl;
+			return;
+		}
+
+		if (pipe2(fromBot, O_CLOEXEC) != 0)
+		{
+			cerr << "cannot start " << command << ": pipe: " << strerror(errno) << endl;
+			close(toBot[0]);
+			close(toBot[1]);
+			return;
+		}
+
+		// the matches run on several threads, so the child may only make async-signal-safe calls: everything it needs is
+		// built before the fork
+		string seedArgument = to_string(seed);
+		char* arguments[] =
+		{ const_cast<char*>(command.c_str()), const_cast<char*>(seedArgument.c_str()), nullptr };
+
+		_pid = fork();
+
+		if (_pid == 0)
+		{
+			dup2(toBot[0], STDIN_FILENO);
+			dup2(fromBot[1], STDOUT_FILENO);
+
+			int devNull = open("/dev/null", O_WRONLY);
+			dup2(devNull, STDERR_FILENO);
+
+			execv(arguments[0], arguments);
+			_exit(127);
+		}
+
+		if (_pid < 0)
+		{
+			cerr << "cannot start " << command << ": fork: " << strerror(errno) << endl;
+			close(toBot[0]);
+			close(toBot[1]);
+			close(fromBot[0]);
+			close(fromBot[1]);
+			return;
+		}
+
+		close(toBot[0]);
+		close(fromBot[1]);
+		_input = toBot[1];
+		_output = fromBot[0];
+	}
+	~BotProcess()
+	{
+		if (_input >= 0)
+			close(_input);
+		if (_output >= 0)
+			close(_output);
+
+		if (_pid > 0)
+		{
+			kill(_pid, SIGKILL);
+			waitpid(_pid, nullptr, 0);
+		}
+	}
+
+	// FUNCTIONS
+public:
+	bool Send(const string& text)
+	{
+		size_t written = 0;
+
+		while (written < text.size())
+		{
+			ssize_t result = write(_input, text.data() + written, text.size() - written);
+
+			if (result <= 0)
+				return false;
+
+			written += result;
+		}
+
+		return true;
+	}
+	/**
+	 * returns false if the bot did not answer before the deadline (ms on the monotonic clock) or stopped
+	 */
+	bool ReadLine(double deadline, string& line)
+	{
+		while (true)
+		{
+			size_t end = _buffer.find('\n');
+
+			if (end != string::npos)
+			{
+				line = _buffer.substr(0, end);
+				_buffer.erase(0, end + 1);
+				return true;
+			}
+
+			int timeout = (int) ceil(deadline - Now());
+
+			if (timeout <= 0)
+				return false;
+
+			pollfd descriptor =
+			{ _output, POLLIN, 0 };
+
+			if (poll(&descriptor, 1, timeout) <= 0)
+				return false;
+
+			char chunk[4096];
+			ssize_t count = read(_output, chunk, sizeof(chunk));
+
+			if (count <= 0)
+				return false;
+
+			_buffer.append(chunk, count);
+		}
+	}
+};
+
+struct MatchResult
+{
+	int winner = -1; // index of the winning bot, -1 for a draw
+	int rum[2] = { 0, 0 };
+	int turns = 0;
+	bool timeout[2] = { false, false };
+	vector<double> latencies; // ms per turn of the first bot, first turn excluded
+};
+
+struct Options
+{
+	int games = 100;
+	unsigned int seed = 1;
+	int threads = 1;
+	bool lenient = false;
+	bool verbose = false;
+	string recordDirectory;
+	string bots[2];
+};
+
+/**
+ * Plays one match. Bot 0 plays the first side on even matches and the second one on odd matches.
+ */
+MatchResult PlayMatch(const Options& options, int matchIndex)
+{
+	unsigned int seed = options.seed + matchIndex;
+	int sideOfBot[2] =
+	{ matchIndex % 2, 1 - matchIndex % 2 };
+
+	Game game(seed);
+	BotProcess firstBot(options.bots[0], seed), secondBot(options.bots[1], seed);
+	BotProcess* bots[2] =
+	{ &firstBot, &secondBot };
+	MatchResult result;
+	bool failed[2] = { false, false };
+
+	ofstream record;
+	if (!options.recordDirectory.empty())
+		record.open(options.recordDirectory + "/match_" + to_string(seed) + ".txt");
+
+	while (!game.IsOver())
+	{
+		double timeout = (game.GetTurn() == 0) ? FIRST_TURN_TIMEOUT : TURN_TIMEOUT;
+
+		for (int bot = 0; bot < 2; bot++)
+		{
+			int side = sideOfBot[bot];
+			double begin = Now();
+			double deadline = begin + (options.lenient ? 10 * FIRST_TURN_TIMEOUT : timeout);
+			vector<string> commands(game.GetShipCount(side));
+
+			string input = game.GetInput(side);
+			bool answered = bots[bot]->Send(input);
+
+			if (bot == 0 && record.is_open())
+				record << input;
+
+			for (unsigned int i = 0; i < commands.size() && answered; i++)
+				answered = bots[bot]->ReadLine(deadline, commands[i]);
+
+			double latency = Now() - begin;
+
+			if (!answered || (!options.lenient && latency > timeout))
+			{
+				failed[bot] = true;
+				result.timeout[bot] = true;
+			}
+			else if (!game.SetActions(side, commands))
+			{
+				failed[bot] = true;
+			}
+
+			if (bot == 0 && game.GetTurn() > 0)
+				result.latencies.push_back(latency);
+		}
+
+		if (failed[0] || failed[1])
+			break;
+
+		game.Update();
+	}
+
+	result.turns = game.GetTurn();
+
+	for (int bot = 0; bot < 2; bot++)
+		result.rum[bot] = failed[bot] ? 0 : game.GetRum(sideOfBot[bot]);
+
+	if (failed[0] != failed[1])
+		result.winner = failed[0] ? 1 : 0;
+	else if (!failed[0] && result.rum[0] != result.rum[1])
+		result.winner = (result.rum[0] > result.rum[1]) ? 0 : 1;
+
+	return result;
+}
+
+double Percentile(const vector<double>& sorted, double fraction)
+{
+	if (sorted.empty())
+		return 0;
+
+	return sorted[min(sorted.size() - 1, (size_t) (fraction * sorted.size()))];
+}
+
+void Report(const Options& options, const vector<MatchResult>& results)
+{
+	int wins = 0, losses = 0, draws = 0, timeouts = 0;
+	double rum[2] = { 0, 0 };
+	double turns = 0;
+	vector<double> latencies;
+
+	for (unsigned int i = 0; i < results.size(); i++)
+	{
+		const MatchResult& result = results[i];
+
+		if (result.winner == 0)
+			wins++;
+		else if (result.winner == 1)
+			losses++;
+		else
+			draws++;
+
+		timeouts += result.timeout[0];
+		rum[0] += result.rum[0];
+		rum[1] += result.rum[1];
+		turns += result.turns;
+		latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+	}
+
+	sort(latencies.begin(), latencies.end());
+	double games = max<size_t>(1, results.size());
+
+	cout << "bot: " << options.bots[0] << endl;
+	cout << "opponent: " << options.bots[1] << endl;
+	cout << "games: " << results.size() << "  wins: " << wins << "  losses: " << losses << "  draws: " << draws << endl;
+	cout << "win rate: " << 100. * (wins + 0.5 * draws) / games << "%" << endl;
+	cout << "rum: " << rum[0] / games << " vs " << rum[1] / games << " (average difference " << (rum[0] - rum[1]) / games << ")"
+			<< endl;
+	cout << "turns: " << turns / games << "  timeouts: " << timeouts << endl;
+	cout << "latency ms: p50=" << Percentile(latencies, 0.5) << " p90=" << Percentile(latencies, 0.9) << " p99="
+			<< Percentile(latencies, 0.99) << " max=" << (latencies.empty() ? 0 : latencies.back()) << endl;
+}
+
+}
+using namespace arena;
+
+//=============================================================
+// MAIN
+//=============================================================
+int main(int argc, char** argv)
+{
+	Options options;
+	options.threads = max(1u, thread::hardware_concurrency());
+	int botCount = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string argument = argv[i];
+
+		if (argument == "--games" && i + 1 < argc)
+			options.games = atoi(argv[++i]);
+		else if (argument == "--seed" && i + 1 < argc)
+			options.seed = strtoul(argv[++i], nullptr, 10);
+		else if (argument == "--threads" && i + 1 < argc)
+			options.threads = max(1, atoi(argv[++i]));
+		else if (argument == "--lenient")
+			options.lenient = true;
+		else if (argument == "--verbose")
+			options.verbose = true;
+		else if (argument == "--record" && i + 1 < argc)
+			options.recordDirectory = argv[++i];
+		else if (botCount < 2)
+			options.bots[botCount++] = argument;
+	}
+
+	if (botCount < 2)
+	{
+		cerr << "usage: referee [--games N] [--seed S] [--threads T] [--lenient] [--verbose] [--record DIR] <bot1> <bot2>" << endl;
+		return 1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	vector<MatchResult> results(options.games);
+	atomic<int> nextMatch(0);
+	mutex outputMutex;
+	vector<thread> workers;
+
+	for (int t = 0; t < options.threads; t++)
+	{
+		workers.emplace_back([&]()
+		{
+			for (int match = nextMatch++; match < options.games; match = nextMatch++)
+			{
+				results[match] = PlayMatch(options, match);
+
+				if (options.verbose)
+				{
+					lock_guard<mutex> lock(outputMutex);
+					cerr << "match " << match << " seed=" << options.seed + match << " winner=" << results[match].winner << " rum="
+					<< results[match].rum[0] << "/" << results[match].rum[1] << " turns=" << results[match].turns << endl;
+				}
+			}
+		});
+	}
+
+	for (unsigned int t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	Report(options, results);
+	return 0;
+}
@@ -1,3 +1,9 @@
+// CodinGame runs on AVX2 hardware but does not pass -mavx2, the batch evaluation enables it here
+#ifndef COTC_NO_SIMD
+#pragma GCC target("avx2")
+#include <immintrin.h>
+#endif
+
 #include <iostream>
 #include <string>
 #include <vector>
@@ -6,6 +12,7 @@
 #include <queue>
 #include <memory>
 #include <ctime>
+#include <cmath>
 
 using namespace std;
 
@@ -15,15 +22,248 @@ using namespace std;
 
 const int MAP_WIDTH = 23;
 const int MAP_HEIGHT = 21;
+const int MAX_TURNS = 200; // the game ends after this turn, the side with the most rum wins
+
+const int MAX_FIRING_RANGE = 4; // turns a cannonball can fly
+const int FIRE_DISTANCE_MAX = 10;
+const int MAX_SHIP_RUM = 100;
+const int BARREL_RUM_THRESHOLD = 70; // ships with more rum than this do not go for barrels
+
+const int HIGH_DAMAGE = 50; // cannonball on the center of a ship
+const int LOW_DAMAGE = 25; // cannonball on the bow or the stern
+const int MINE_DAMAGE = 25;
+const int NEAR_MINE_DAMAGE = 10;
+const int COOLDOWN_MINE = 5;
+const int COOLDOWN_CANNON = 2;
+const int REWARD_RUM_BARREL_VALUE = 30; // most rum a sunk ship leaves in a barrel
+
+const double FIRST_TURN_TIME = 900; // ms, the referee allows 1000 on the first turn
+const double TURN_TIME = 40; // ms, the referee allows 50 but starts its clock before sending the turn
+
+//#############################################################
+//#############################################################
+// NAMESPACE TIMING
+//#############################################################
+//#############################################################
+
+namespace timing
+{
+
+//=============================================================
+// FUNCTIONS
+//=============================================================
+
+/**
+ * Milliseconds on a monotonic clock, only meaningful as a difference or a deadline.
+ */
+double Now()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000. + now.tv_nsec / 1000000.;
+}
+
+bool IsPast(double deadline)
+{
+	return Now() >= deadline;
+}
+
+//=============================================================
+// STRUCTS
+//=============================================================
+
+/**
+ * Hands out the time of one turn as slices (one per ship). Every slice is the remaining turn time divided by the number of
+ * slices still to come, so time a ship did not use is automatically given to the following ones.
+ */
+class TurnBudget
+{
+	// VARIABLES
+private:
+	double _begin = 0;
+	double _deadline = 0;
+	int _slicesLeft = 0;
+
+	// FUNCTIONS
+public:
+	void StartTurn(double turnTime, int slices)
+	{
+		_begin = Now();
+		_deadline = _begin + turnTime;
+		_slicesLeft = slices;
+	}
+	double NextSlice()
+	{
+		if (_slicesLeft <= 1)
+		{
+			_slicesLeft = 0;
+			return _deadline;
+		}
+
+		double now = Now();
+		double slice = max(0., (_deadline - now) / _slicesLeft);
+		_slicesLeft--;
+		return now + slice;
+	}
+	double GetDeadline() const
+	{
+		return _deadline;
+	}
+	double Elapsed() const
+	{
+		return Now() - _begin;
+	}
+	double Remaining() const
+	{
+		return _deadline - Now();
+	}
+};
+
+}
+using namespace timing;
+
+//#############################################################
+//#############################################################
+// NAMESPACE MEMORY
+//#############################################################
+//#############################################################
+
+namespace memory
+{
+
+//=============================================================
+// CONSTANTS
+//=============================================================
+
+const size_t TURN_ARENA_SIZE = 4 << 20; // bytes: turns of the recorded matches peak at 160 KB, a search using the whole turn needs 3.5 MB
+
+//=============================================================
+// STRUCTS
+//=============================================================
 
-const int MAX_FIRING_RANGE = 4;
+/**
+ * Bump allocator for everything that only lives for one turn. Memory is never freed on its own: Reset makes all of it
+ * available again. When a turn needs more than the capacity, a new block is added and kept for the following turns, so the
+ * game loop does not call malloc once the peak has been reached.
+ */
+class Arena
+{
+	// VARIABLES
+private:
+	vector<char*> _blocks;
+	vector<size_t> _blockSizes;
+	unsigned int _block = 0; // block the allocations are taken from
+	size_t _offset = 0; // used bytes of that block
+	size_t _used = 0; // bytes handed out since the last reset
+	size_t _peak = 0;
+
+	// CONSTRUCTORS
+public:
+	Arena(size_t capacity)
+	{
+		_blocks.push_back(new char[capacity]);
+		_blockSizes.push_back(capacity);
+	}
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+	~Arena()
+	{
+		for (unsigned int i = 0; i < _blocks.size(); i++)
+			delete[] _blocks[i];
+	}
+
+	// FUNCTIONS
+public:
+	void* Allocate(size_t size, size_t alignment)
+	{
+		size_t offset = (_offset + alignment - 1) & ~(alignment - 1);
+
+		while (offset + size > _blockSizes[_block])
+		{
+			if (_block + 1 == _blocks.size())
+			{
+				size_t capacity = max(size, 2 * _blockSizes.back());
+				_blocks.push_back(new char[capacity]);
+				_blockSizes.push_back(capacity);
+			}
+
+			_block++;
+			offset = 0;
+		}
+
+		_used += offset + size - _offset;
+		_offset = offset + size;
+		return _blocks[_block] + offset;
+	}
+	template<typename T, typename ... Args>
+	T* Create(Args&&... args)
+	{
+		return new (Allocate(sizeof(T), alignof(T))) T(forward<Args>(args)...);
+	}
+	/**
+	 * Frees everything at once. Objects taken from the arena are not destroyed, so they must not own other memory.
+	 */
+	void Reset()
+	{
+		_peak = max(_peak, _used);
+		_block = 0;
+		_offset = 0;
+		_used = 0;
+	}
+	size_t GetUsed() const
+	{
+		return _used;
+	}
+	size_t GetPeak() const
+	{
+		return max(_peak, _used);
+	}
+};
+
+Arena TURN_ARENA(TURN_ARENA_SIZE);
 
-double elapsed(timespec& begin)
+/**
+ * Standard allocator on the turn arena, for the containers of the game loop. Deallocation does nothing, the memory comes
+ * back with the next reset.
+ */
+template<typename T>
+class ArenaAllocator
 {
-	timespec end;
-	clock_gettime(CLOCK_REALTIME, &end);
-	return (end.tv_nsec - begin.tv_nsec) / 1000000.;
+public:
+	typedef T value_type;
+
+	ArenaAllocator()
+	{
+	}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>&)
+	{
+	}
+
+	T* allocate(size_t count)
+	{
+		return static_cast<T*>(TURN_ARENA.Allocate(count * sizeof(T), alignof(T)));
+	}
+	void deallocate(T*, size_t)
+	{
+	}
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>&) const
+	{
+		return true;
+	}
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>&) const
+	{
+		return false;
+	}
+};
+
+template<typename T>
+using ArenaVector = vector<T, ArenaAllocator<T>>;
+
 }
+using namespace memory;
 
 //#############################################################
 //#############################################################
@@ -203,6 +443,7 @@ private:
 
 	bool updated;
 	int hasFired;
+	int mineCooldown;
 	OffsetCoord wanderTarget;
 
 	// CONSTRUCTORS
@@ -213,7 +454,7 @@ public:
 		this->y = -1;
 
 		_entityId = rotation = speed = rum = -1;
-		hasFired = 0;
+		hasFired = mineCooldown = 0;
 		updated = true;
 	}
 	Ship(int entityId, int x, int y, int rotation, int speed, int rum)
@@ -226,7 +467,7 @@ public:
 		this->speed = speed;
 		this->rum = rum;
 
-		hasFired = 0;
+		hasFired = mineCooldown = 0;
 		updated = true;
 	}
 	Ship(const Ship& ship)
@@ -240,8 +481,11 @@ public:
 		this->rum = ship.rum;
 
 		this->hasFired = ship.hasFired;
+		this->mineCooldown = ship.mineCooldown;
 		this->updated = ship.updated;
 	}
+	// declared because of the copy constructor above, implicit copy assignment is deprecated then
+	Ship& operator=(const Ship& ship) = default;
 
 	// FUNCTIONS
 public:
@@ -259,6 +503,9 @@ public:
 		else if (hasFired == 2)
 			hasFired = 0;
 
+		if (mineCooldown > 0)
+			mineCooldown--;
+
 		updated = true;
 	}
 	OffsetCoord GetCenterPosOffset() const
@@ -335,6 +582,21 @@ public:
 	{
 		hasFired = value;
 	}
+	int GetMineCooldown() const
+	{
+		return mineCooldown;
+	}
+	void SetMineCooldown(int value)
+	{
+		mineCooldown = value;
+	}
+	/**
+	 * Cell where a MINE command would drop the mine: right behind the stern.
+	 */
+	OffsetCoord GetMinePos() const
+	{
+		return CubeToOffset(OffsetToCube(GetBackPos()) + DIRECTIONS[GetOppositeDirection(this->rotation)]);
+	}
 	OffsetCoord GetWanderTarget() const
 	{
 		return wanderTarget;
@@ -372,9 +634,6 @@ public:
 		if (object == "e")
 			return true;
 
-		if (object[0] == 'C' && object != string("C") + to_string(turn + 1))
-			return true;
-
 		if ((object[0] == 'S' && turn > 1) || object == (string("S") + to_string(_entityId)))
 			return true;
 
@@ -430,360 +689,3812 @@ using namespace gamedata;
 
 //#############################################################
 //#############################################################
-// NAMESPACE PATHFINDER
+// NAMESPACE KINEMATICS
 //#############################################################
 //#############################################################
 
-namespace pathfinder
+namespace kinematics
 {
 
-class Action
+//=============================================================
+// CONSTANTS
+//=============================================================
+
+const int MAP_SIZE = MAP_WIDTH * MAP_HEIGHT;
+const int MAX_SHIP_SPEED = 2;
+
+// a pose is (cell, rotation), a state is (cell, rotation, speed)
+const int POSE_COUNT = MAP_SIZE * 6;
+const int STATE_COUNT = POSE_COUNT * (MAX_SHIP_SPEED + 1);
+
+enum Move
 {
-// VARIABLES
+	MOVE_WAIT, MOVE_PORT, MOVE_STARBOARD, MOVE_FASTER, MOVE_SLOWER, MOVE_COUNT
+};
+
+const char* const MOVE_COMMANDS[MOVE_COUNT] =
+{ "WAIT", "PORT", "STARBOARD", "FASTER", "SLOWER" };
+
+const unsigned char UNREACHABLE = 255;
+
+// successors of up to 64 states with all their moves
+const int MAX_BATCH_SIZE = 64 * MOVE_COUNT;
+
+//=============================================================
+// FUNCTIONS
+//=============================================================
+
+inline int ToPose(int cell, int rotation)
+{
+	return cell * 6 + rotation;
+}
+
+inline int ToState(int cell, int rotation, int speed)
+{
+	return ToPose(cell, rotation) * (MAX_SHIP_SPEED + 1) + speed;
+}
+
+inline int ToState(const Ship& ship)
+{
+	return ToState(OffsetToIndex(ship.GetCenterPosOffset()), ship.GetRotation(), ship.GetSpeed());
+}
+
+inline int StatePose(int state)
+{
+	return state / (MAX_SHIP_SPEED + 1);
+}
+
+inline int StateCell(int state)
+{
+	return StatePose(state) / 6;
+}
+
+inline int StateRotation(int state)
+{
+	return StatePose(state) % 6;
+}
+
+inline int StateSpeed(int state)
+{
+	return state % (MAX_SHIP_SPEED + 1);
+}
+
+inline bool IsInsideMap(const OffsetCoord& offset)
+{
+	return offset.col >= 0 && offset.col < MAP_WIDTH && offset.row >= 0 && offset.row < MAP_HEIGHT;
+}
+
+inline CubeCoord CellToCube(int cell)
+{
+	return OffsetToCube(OffsetCoord(cell % MAP_WIDTH, cell / MAP_WIDTH));
+}
+
+/**
+ * Number of turns a cannonball fired from the given distance takes to land.
+ */
+inline int ComputeTravelTime(int distance)
+{
+	return 1 + (int) round(distance / 3.0);
+}
+
+//=============================================================
+// STRUCTS
+//=============================================================
+
+/**
+ * Successor states in structure-of-arrays form, so that their legality and heuristic can be looked up for 8 states at a
+ * time. Entries are in the order of the expanded states, then of the moves.
+ */
+struct StateBatch
+{
+	int count = 0;
+
+	alignas(32) int states[MAX_BATCH_SIZE];
+	alignas(32) int poses[MAX_BATCH_SIZE];
+	alignas(32) int cells[MAX_BATCH_SIZE];
+	alignas(32) int rotations[MAX_BATCH_SIZE];
+	alignas(32) int speeds[MAX_BATCH_SIZE];
+	alignas(32) int parents[MAX_BATCH_SIZE]; // index of the expanded state
+	alignas(32) int moves[MAX_BATCH_SIZE];
+
+	// filled in by DistanceFieldCache::EvaluateBatch
+	alignas(32) int legal[MAX_BATCH_SIZE];
+	alignas(32) int heuristics[MAX_BATCH_SIZE];
+};
+
+/**
+ * Precomputed ship geometry: bow and stern of every pose and the cell reached by moving forward, following the same
+ * rules as the pathfinder actions (speed change, then move, then rotation). Cells outside of the map are -1.
+ */
+class Kinematics
+{
+	// VARIABLES
 private:
-	int _turn = 0;
-protected:
-	string _firstCommand = "";
-	Ship _shipState;
-	int _heuristic = 0;
+	int _bow[POSE_COUNT];
+	int _stern[POSE_COUNT];
+	int _forward[POSE_COUNT][MAX_SHIP_SPEED + 1];
+	int _successors[STATE_COUNT][MOVE_COUNT];
 
-// CONSTRUCTORS
-protected:
-	Action(shared_ptr<Action> previousAction)
+	// CONSTRUCTORS
+public:
+	Kinematics()
 	{
-		if (previousAction != nullptr)
+		for (int cell = 0; cell < MAP_SIZE; cell++)
 		{
-			if (previousAction->GetFirstCommand() != "")
-				_firstCommand = previousAction->GetFirstCommand();
-			else
-				_firstCommand = previousAction->GetCommand();
+			CubeCoord center = OffsetToCube(OffsetCoord(cell % MAP_WIDTH, cell / MAP_WIDTH));
 
-			_turn = previousAction->_turn + 1;
+			for (int rotation = 0; rotation < 6; rotation++)
+			{
+				int pose = ToPose(cell, rotation);
+				_bow[pose] = ToCell(center + DIRECTIONS[rotation]);
+				_stern[pose] = ToCell(center + DIRECTIONS[GetOppositeDirection(rotation)]);
+
+				for (int speed = 0; speed <= MAX_SHIP_SPEED; speed++)
+					_forward[pose][speed] = ToCell(center + DIRECTIONS[rotation] * speed);
+			}
 		}
-	}
-public:
-	Action()
-	{
-	}
-	Action(const Action& action)
-	{
-		_firstCommand = action._firstCommand;
-		_turn = action._turn;
-		_shipState = Ship(action._shipState);
-		_heuristic = action._heuristic;
-	}
-	virtual ~Action()
-	{
-	}
 
-// FUNCTIONS
-protected:
-	void ComputeMove()
-	{
-		if (_shipState.GetSpeed() > 0)
+		for (int state = 0; state < STATE_COUNT; state++)
 		{
-			OffsetCoord newPos = CubeToOffset(
-					_shipState.GetCenterPosCube() + (DIRECTIONS[_shipState.GetRotation()] * _shipState.GetSpeed()));
-			_shipState.SetPos(newPos);
+			for (int move = 0; move < MOVE_COUNT; move++)
+				_successors[state][move] = ApplyMove(state, move);
 		}
 	}
-	void ComputeHeuristic(const CubeCoord& destination)
+
+	// FUNCTIONS
+private:
+	static int ToCell(const CubeCoord& cube)
 	{
-		//_heuristic = 0;
-		_heuristic = ComputeDistance(destination, OffsetToCube(_shipState.GetFrontPos()));
+		OffsetCoord offset = CubeToOffset(cube);
+
+		if (!IsInsideMap(offset))
+			return -1;
+
+		return OffsetToIndex(offset);
 	}
 public:
-	string GetFirstCommand() const
+	int GetBow(int pose) const
 	{
-		return _firstCommand;
+		return _bow[pose];
 	}
-	int GetTotalCost()
-	{
-		return _turn + _heuristic;
-	}
-	Ship GetShipState() const
+	int GetStern(int pose) const
 	{
-		return _shipState;
+		return _stern[pose];
 	}
-	bool IsLegal(const vector<string>* obstacleMap) const
+	const int* GetBows() const
 	{
-		return _shipState.IsShipPositionLegal(obstacleMap, _turn);
+		return _bow;
 	}
-	virtual string GetCommand()=0;
-};
-
-class WaitAction: public Action
-{
-public:
-	WaitAction(const Ship& initialState, shared_ptr<Action> previousAction, const CubeCoord& destination) :
-			Action(previousAction)
+	const int* GetSterns() const
 	{
-		_shipState = Ship(initialState);
-
-		if (_firstCommand == "")
-			_firstCommand = "WAIT";
-
-		ComputeMove();
-		ComputeHeuristic(destination);
+		return _stern;
 	}
-	string GetCommand()
+	/**
+	 * Same as ApplyMove, from the precomputed table.
+	 */
+	int GetSuccessor(int state, int move) const
 	{
-		return "WAIT";
+		return _successors[state][move];
 	}
-};
-
-class PortAction: public Action
-{
-public:
-	PortAction(const Ship& initialState, shared_ptr<Action> previousAction, const CubeCoord& destination) :
-			Action(previousAction)
+	/**
+	 * Appends the successors of the states to the batch, skipping the moves that are not allowed or leave the map.
+	 *
+	 * returns the number of states expanded, less than count if the batch is full
+	 */
+	int ExpandBatch(const int* states, int count, StateBatch& batch) const
 	{
-		_shipState = Ship(initialState);
+		int expanded = 0;
 
-		if (_firstCommand == "")
-			_firstCommand = "PORT";
-
-		ComputeMove();
+		for (; expanded < count && batch.count + MOVE_COUNT <= MAX_BATCH_SIZE; expanded++)
+		{
+			const int* successors = _successors[states[expanded]];
 
-		_shipState.SetRotation(RoundDirection(_shipState.GetRotation() + 1));
+			for (int move = 0; move < MOVE_COUNT; move++)
+			{
+				int next = successors[move];
+
+				if (next < 0)
+					continue;
+
+				int i = batch.count++;
+				batch.states[i] = next;
+				batch.poses[i] = StatePose(next);
+				batch.cells[i] = StateCell(next);
+				batch.rotations[i] = StateRotation(next);
+				batch.speeds[i] = StateSpeed(next);
+				batch.parents[i] = expanded;
+				batch.moves[i] = move;
+			}
+		}
 
-		ComputeHeuristic(destination);
+		return expanded;
 	}
-	string GetCommand()
+	/**
+	 * returns the state after the move or -1 if the move is not allowed or the center leaves the map
+	 */
+	int ApplyMove(int state, int move) const
 	{
-		return "PORT";
-	}
+		int cell = StateCell(state);
+		int rotation = StateRotation(state);
+		int speed = StateSpeed(state);
+
+		switch (move)
+		{
+		case MOVE_WAIT:
+			if (speed == 0)
+				return -1;
+			break;
+		case MOVE_FASTER:
+			if (speed == MAX_SHIP_SPEED)
+				return -1;
+			speed++;
+			break;
+		case MOVE_SLOWER:
+			if (speed == 0)
+				return -1;
+			speed--;
+			break;
+		}
+
+		cell = _forward[ToPose(cell, rotation)][speed];
+
+		if (cell < 0)
+			return -1;
+
+		if (move == MOVE_PORT)
+			rotation = RoundDirection(rotation + 1);
+		else if (move == MOVE_STARBOARD)
+			rotation = RoundDirection(rotation - 1);
+
+		return ToState(cell, rotation, speed);
+	}
+};
+
+const Kinematics KINEMATICS;
+
+typedef ArenaVector<unsigned char> DistanceField;
+
+// fields are read 4 bytes at a time by the batch evaluation
+const int DISTANCE_FIELD_PADDING = 3;
+
+/**
+ * Exact number of moves from every state to a state with the bow on a destination, ignoring everything that changes
+ * during the search (cannonballs, ships). It is built per turn with a reverse BFS and is an admissible heuristic for A*.
+ * Fields are cached per destination until the next Reset, so all commands share them.
+ */
+class DistanceFieldCache
+{
+	// VARIABLES
+private:
+	int _legal[POSE_COUNT]; // 1 if the pose is inside the map and not on a mine
+	int _occupants[MAP_SIZE]; // id of the ship on the cell or -1
+	vector<int> _predecessorOffsets;
+	vector<int> _predecessors;
+	vector<int> _openStates;
+	vector<pair<int, DistanceField>> _fields;
+
+	// FUNCTIONS
+public:
+	void Reset(const vector<string>* objectMap)
+	{
+		_fields.clear();
+
+		for (int pose = 0; pose < POSE_COUNT; pose++)
+		{
+			int center = pose / 6;
+			int bow = KINEMATICS.GetBow(pose);
+			int stern = KINEMATICS.GetStern(pose);
+
+			_legal[pose] = bow >= 0 && stern >= 0 && objectMap->at(center) != "M" && objectMap->at(bow) != "M"
+					&& objectMap->at(stern) != "M";
+		}
+
+		for (int cell = 0; cell < MAP_SIZE; cell++)
+		{
+			const string& object = objectMap->at(cell);
+			_occupants[cell] = (object[0] == 'S') ? atoi(object.c_str() + 1) : -1;
+		}
+
+		// reverse graph in compressed rows: predecessors of state s are _predecessors[_predecessorOffsets[s].._predecessorOffsets[s + 1]]
+		_predecessorOffsets.assign(STATE_COUNT + 1, 0);
+		_predecessors.resize(STATE_COUNT * MOVE_COUNT);
+
+		for (int state = 0; state < STATE_COUNT; state++)
+		{
+			for (int move = 0; move < MOVE_COUNT; move++)
+			{
+				int next = KINEMATICS.ApplyMove(state, move);
+
+				if (next >= 0 && _legal[StatePose(next)])
+					_predecessorOffsets[next + 1]++;
+			}
+		}
+
+		for (int state = 0; state < STATE_COUNT; state++)
+			_predecessorOffsets[state + 1] += _predecessorOffsets[state];
+
+		ArenaVector<int> fill(_predecessorOffsets.begin(), _predecessorOffsets.end() - 1);
+
+		for (int state = 0; state < STATE_COUNT; state++)
+		{
+			for (int move = 0; move < MOVE_COUNT; move++)
+			{
+				int next = KINEMATICS.ApplyMove(state, move);
+
+				if (next >= 0 && _legal[StatePose(next)])
+					_predecessors[fill[next]++] = state;
+			}
+		}
+	}
+	bool IsLegal(int pose) const
+	{
+		return _legal[pose];
+	}
+	/**
+	 * Legality of a single state the given number of moves from now, with the rules of EvaluateBatch.
+	 */
+	bool IsStateLegal(int state, int shipId, int turn) const
+	{
+		int pose = StatePose(state);
+
+		if (!_legal[pose])
+			return false;
+
+		if (turn > 1)
+			return true;
+
+		int cells[3] =
+		{ StateCell(state), KINEMATICS.GetBow(pose), KINEMATICS.GetStern(pose) };
+
+		for (int c = 0; c < 3; c++)
+		{
+			if (_occupants[cells[c]] >= 0 && _occupants[cells[c]] != shipId)
+				return false;
+		}
+
+		return true;
+	}
+	/**
+	 * Legality and heuristic of every state of the batch, with the rules of Ship::IsShipPositionLegal: the ship must be
+	 * inside the map and off the mines, and off the other ships for the first turns of a path.
+	 */
+	void EvaluateBatch(StateBatch& batch, const DistanceField* distanceField, int shipId, int turn) const
+	{
+		int i = 0;
+
+#ifndef COTC_NO_SIMD
+		bool checkShips = turn <= 1;
+		const int* bows = KINEMATICS.GetBows();
+		const int* sterns = KINEMATICS.GetSterns();
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i one = _mm256_set1_epi32(1);
+		const __m256i empty = _mm256_set1_epi32(-1);
+		const __m256i self = _mm256_set1_epi32(shipId);
+		const __m256i byteMask = _mm256_set1_epi32(0xFF);
+
+		for (; i + 8 <= batch.count; i += 8)
+		{
+			__m256i poses = _mm256_load_si256((const __m256i*) (batch.poses + i));
+			__m256i legal = _mm256_i32gather_epi32(_legal, poses, 4);
+
+			if (checkShips)
+			{
+				// outside of the map the bow and stern are -1, those lanes are already illegal
+				__m256i cells[3] =
+				{ _mm256_load_si256((const __m256i*) (batch.cells + i)), _mm256_max_epi32(_mm256_i32gather_epi32(bows, poses, 4), zero),
+						_mm256_max_epi32(_mm256_i32gather_epi32(sterns, poses, 4), zero) };
+
+				for (int c = 0; c < 3; c++)
+				{
+					__m256i occupant = _mm256_i32gather_epi32(_occupants, cells[c], 4);
+					__m256i isFree = _mm256_or_si256(_mm256_cmpeq_epi32(occupant, empty), _mm256_cmpeq_epi32(occupant, self));
+					legal = _mm256_and_si256(legal, _mm256_and_si256(isFree, one));
+				}
+			}
+
+			_mm256_store_si256((__m256i*) (batch.legal + i), legal);
+
+			__m256i heuristics = zero;
+			if (distanceField != nullptr)
+			{
+				__m256i states = _mm256_load_si256((const __m256i*) (batch.states + i));
+				heuristics = _mm256_and_si256(_mm256_i32gather_epi32((const int*) distanceField->data(), states, 1), byteMask);
+			}
+
+			_mm256_store_si256((__m256i*) (batch.heuristics + i), heuristics);
+		}
+#endif
+
+		for (; i < batch.count; i++)
+		{
+			batch.legal[i] = IsStateLegal(batch.states[i], shipId, turn);
+			batch.heuristics[i] = (distanceField != nullptr) ? (*distanceField)[batch.states[i]] : 0;
+		}
+	}
+	const DistanceField* Get(const OffsetCoord& destination)
+	{
+		if (!IsInsideMap(destination))
+			return nullptr;
+
+		int destinationCell = OffsetToIndex(destination);
+
+		for (unsigned int i = 0; i < _fields.size(); i++)
+		{
+			if (_fields[i].first == destinationCell)
+				return &_fields[i].second;
+		}
+
+		_fields.emplace_back(destinationCell, DistanceField(STATE_COUNT + DISTANCE_FIELD_PADDING, UNREACHABLE));
+		DistanceField& field = _fields.back().second;
+		_openStates.clear();
+
+		for (int pose = 0; pose < POSE_COUNT; pose++)
+		{
+			if (!_legal[pose] || KINEMATICS.GetBow(pose) != destinationCell)
+				continue;
+
+			for (int speed = 0; speed <= MAX_SHIP_SPEED; speed++)
+			{
+				int state = pose * (MAX_SHIP_SPEED + 1) + speed;
+				field[state] = 0;
+				_openStates.push_back(state);
+			}
+		}
+
+		for (unsigned int head = 0; head < _openStates.size(); head++)
+		{
+			int state = _openStates[head];
+			int distance = field[state] + 1;
+
+			if (distance >= UNREACHABLE)
+				continue;
+
+			for (int i = _predecessorOffsets[state]; i < _predecessorOffsets[state + 1]; i++)
+			{
+				int previous = _predecessors[i];
+
+				if (field[previous] == UNREACHABLE)
+				{
+					field[previous] = distance;
+					_openStates.push_back(previous);
+				}
+			}
+		}
+
+		return &field;
+	}
+};
+
+}
+using namespace kinematics;
+
+//#############################################################
+//#############################################################
+// NAMESPACE TRACKING
+//#############################################################
+//#############################################################
+
+namespace tracking
+{
+
+//=============================================================
+// CONSTANTS
+//=============================================================
+
+const int TRACK_HISTORY = 4;
+
+// commands inferred from what the enemy ships did: the moves, then FIRE (a MINE cannot be told apart from a WAIT)
+const int INFERRED_FIRE = MOVE_COUNT;
+const int INFERRED_COMMAND_COUNT = MOVE_COUNT + 1;
+
+// how likely an enemy is to pick each move when nothing else is known about it
+const float DEFAULT_MOVE_WEIGHTS[MOVE_COUNT] =
+{ 0.5f, 0.1f, 0.1f, 0.2f, 0.1f };
+const float MODEL_PRIOR_TURNS = 10; // weight of the default moves against the commands counted for the opponent
+const float RECENT_MOVES_SHARE = 0.5f; // of the prediction that follows the last TRACK_HISTORY commands of the ship
+
+//=============================================================
+// STRUCTS
+//=============================================================
+
+/**
+ * What one enemy ship did over the last TRACK_HISTORY turns.
+ */
+struct ShipTrack
+{
+	int entityId = -1;
+	Ship previous;
+	int turnsTracked = 0;
+	int commands[TRACK_HISTORY] = { }; // inferred, -1 when a collision hid the command
+};
+
+struct Cannonball
+{
+	int entityId = -1;
+	int shooterId = -1;
+	OffsetCoord target;
+	OffsetCoord origin; // bow of the shooter when it fired, null if it fired before we saw it
+	int remainingTurns = 0;
+	bool updated = true;
+	bool isNew = false;
+};
+
+//=============================================================
+// FUNCTIONS
+//=============================================================
+
+/**
+ * Move that takes a ship from one state to the next, or -1 when none does (a collision stopped the ship).
+ */
+int InferMove(int from, int to)
+{
+	if (from == to && StateSpeed(from) == 0)
+		return MOVE_WAIT;
+
+	for (int move = 0; move < MOVE_COUNT; move++)
+	{
+		if (KINEMATICS.ApplyMove(from, move) == to)
+			return move;
+	}
+
+	return -1;
+}
+
+//=============================================================
+// CLASSES
+//=============================================================
+
+/**
+ * Keeps the enemy ships and the cannonballs across turns, keyed by entity id. Enemy ships are updated in place like our
+ * own ships, so the per-turn data (command history, cannon cooldown) is derived incrementally. The commands inferred for
+ * all the enemy ships are also counted, as a model of the opponent.
+ */
+class EntityTracker
+{
+	// VARIABLES
+private:
+	vector<Ship> _enemyShips;
+	vector<ShipTrack> _tracks;
+	vector<Cannonball> _cannonballs;
+	int _commandCounts[INFERRED_COMMAND_COUNT] = { };
+	int _commandTotal = 0;
+
+	// FUNCTIONS
+private:
+	ShipTrack* GetTrack(int entityId)
+	{
+		for (unsigned int i = 0; i < _tracks.size(); i++)
+		{
+			if (_tracks[i].entityId == entityId)
+				return &_tracks[i];
+		}
+
+		return nullptr;
+	}
+	void RecordMotion(ShipTrack& track, const Ship& ship)
+	{
+		int command = InferMove(ToState(track.previous), ToState(ship));
+
+		track.commands[track.turnsTracked % TRACK_HISTORY] = command;
+		track.turnsTracked++;
+
+		if (command >= 0)
+		{
+			_commandCounts[command]++;
+			_commandTotal++;
+		}
+	}
+	/**
+	 * The ship fired last turn, so the WAIT it seemed to do was a FIRE.
+	 */
+	void RecordFire(ShipTrack& track)
+	{
+		int& command = track.commands[(track.turnsTracked - 1) % TRACK_HISTORY];
+
+		if (command != MOVE_WAIT)
+			return;
+
+		command = INFERRED_FIRE;
+		_commandCounts[MOVE_WAIT]--;
+		_commandCounts[INFERRED_FIRE]++;
+	}
+public:
+	void BeginTurn()
+	{
+		for (unsigned int i = 0; i < _enemyShips.size(); i++)
+			_enemyShips[i].SetUpdated(false);
+
+		for (unsigned int i = 0; i < _cannonballs.size(); i++)
+			_cannonballs[i].updated = false;
+	}
+	Ship* UpdateEnemyShip(int entityId, int x, int y, int rotation, int speed, int rum)
+	{
+		Ship* ship = GetShip(_enemyShips, entityId);
+
+		if (ship == nullptr)
+		{
+			_enemyShips.emplace_back(entityId, x, y, rotation, speed, rum);
+			_tracks.emplace_back();
+			_tracks.back().entityId = entityId;
+			_tracks.back().previous = _enemyShips.back();
+			return &_enemyShips.back();
+		}
+
+		ShipTrack* track = GetTrack(entityId);
+		track->previous = *ship;
+		ship->Update(x, y, rotation, speed, rum);
+		RecordMotion(*track, *ship);
+
+		return ship;
+	}
+	void UpdateCannonball(int entityId, int x, int y, int shooterId, int remainingTurns)
+	{
+		for (unsigned int i = 0; i < _cannonballs.size(); i++)
+		{
+			if (_cannonballs[i].entityId == entityId)
+			{
+				_cannonballs[i].remainingTurns = remainingTurns;
+				_cannonballs[i].updated = true;
+				return;
+			}
+		}
+
+		Cannonball cannonball;
+		cannonball.entityId = entityId;
+		cannonball.shooterId = shooterId;
+		cannonball.target = OffsetCoord(x, y);
+		cannonball.remainingTurns = remainingTurns;
+		cannonball.isNew = true;
+
+		_cannonballs.push_back(cannonball);
+	}
+	/**
+	 * Links new cannonballs to their shooter and forgets sunk ships and exploded cannonballs, to be called once all
+	 * entities of the turn have been read.
+	 */
+	void EndTurn()
+	{
+		for (unsigned int i = 0; i < _cannonballs.size(); i++)
+		{
+			Cannonball& cannonball = _cannonballs[i];
+
+			if (!cannonball.isNew)
+				continue;
+
+			cannonball.isNew = false;
+
+			// a new cannonball was fired last turn, from the bow the shooter had before moving
+			ShipTrack* track = GetTrack(cannonball.shooterId);
+			Ship* shooter = GetShip(_enemyShips, cannonball.shooterId);
+
+			if (track != nullptr && shooter != nullptr && track->turnsTracked > 0)
+			{
+				cannonball.origin = track->previous.GetFrontPos();
+				shooter->SetHasFired(2);
+				RecordFire(*track);
+			}
+		}
+
+		for (unsigned int i = 0; i < _enemyShips.size(); i++)
+		{
+			if (!_enemyShips[i].GetUpdated())
+			{
+				_tracks.erase(_tracks.begin() + i);
+				_enemyShips.erase(_enemyShips.begin() + i);
+				i--;
+			}
+		}
+
+		for (unsigned int i = 0; i < _cannonballs.size(); i++)
+		{
+			if (!_cannonballs[i].updated)
+			{
+				_cannonballs.erase(_cannonballs.begin() + i);
+				i--;
+			}
+		}
+	}
+	const vector<Ship>& GetEnemyShips() const
+	{
+		return _enemyShips;
+	}
+	const vector<Cannonball>& GetCannonballs() const
+	{
+		return _cannonballs;
+	}
+	const ShipTrack* GetTrack(int entityId) const
+	{
+		return const_cast<EntityTracker*>(this)->GetTrack(entityId);
+	}
+	bool CanFire(int entityId) const
+	{
+		for (unsigned int i = 0; i < _enemyShips.size(); i++)
+		{
+			if (_enemyShips[i].GetEntityId() == entityId)
+				return _enemyShips[i].GetHasFired() == 0;
+		}
+
+		return false;
+	}
+	/**
+	 * Probabilities of the moves of an enemy ship, summing to 1: the frequencies of the commands of the opponent, starting
+	 * from the default weights, shifted towards what the ship did recently. A FIRE moves the ship like a WAIT.
+	 */
+	void GetMoveWeights(int entityId, float* weights) const
+	{
+		float total = MODEL_PRIOR_TURNS + _commandTotal;
+
+		for (int move = 0; move < MOVE_COUNT; move++)
+			weights[move] = (DEFAULT_MOVE_WEIGHTS[move] * MODEL_PRIOR_TURNS + _commandCounts[move]) / total;
+
+		weights[MOVE_WAIT] += _commandCounts[INFERRED_FIRE] / total;
+
+		const ShipTrack* track = GetTrack(entityId);
+
+		if (track == nullptr)
+			return;
+
+		int history = min(track->turnsTracked, TRACK_HISTORY);
+		int known = 0;
+
+		for (int i = 0; i < history; i++)
+			known += track->commands[i] >= 0;
+
+		if (known == 0)
+			return;
+
+		for (int move = 0; move < MOVE_COUNT; move++)
+			weights[move] *= 1 - RECENT_MOVES_SHARE;
+
+		for (int i = 0; i < history; i++)
+		{
+			int command = track->commands[i];
+
+			if (command >= 0)
+				weights[(command == INFERRED_FIRE) ? MOVE_WAIT : command] += RECENT_MOVES_SHARE / known;
+		}
+	}
+};
+
+}
+using namespace tracking;
+
+//#############################################################
+//#############################################################
+// NAMESPACE DANGER
+//#############################################################
+//#############################################################
+
+namespace danger
+{
+
+//=============================================================
+// CONSTANTS
+//=============================================================
+
+const int DANGER_HORIZON = MAX_FIRING_RANGE + 1;
+
+// chance that an enemy with a loaded cannon shoots where one of our ships would be if it kept going straight
+const float LIKELY_FIRE_PROBABILITY = 0.3f;
+
+//=============================================================
+// STRUCTS
+//=============================================================
+
+/**
+ * Expected damage per cell for each of the next DANGER_HORIZON turns, from cannonballs in flight, mines (and their
+ * explosions when a cannonball lands on them) and the shots enemies are likely to fire at us. Damage is split between
+ * what a ship takes with its center on a cell and with its bow or stern on it, so a ship state is evaluated with three
+ * lookups. The splash of an exploding mine hits a ship once whichever of its parts is next to the mine, so it is kept per
+ * pose and makes a fourth lookup. Turn 1 is the state after our next move; turns beyond the horizon use the last one.
+ */
+class DangerMap
+{
+	// VARIABLES
+private:
+	float _centerDamage[DANGER_HORIZON + 1][MAP_SIZE];
+	float _hullDamage[DANGER_HORIZON + 1][MAP_SIZE];
+	float _splashDamage[DANGER_HORIZON + 1][POSE_COUNT];
+
+	// FUNCTIONS
+private:
+	void AddImpact(int turn, int cell, float probability, const ArenaVector<bool>& isMine)
+	{
+		_centerDamage[turn][cell] += probability * HIGH_DAMAGE;
+		_hullDamage[turn][cell] += probability * LOW_DAMAGE;
+
+		if (!isMine[cell])
+			return;
+
+		// the mine explodes and damages every ship with its center, bow or stern next to it, like in the referee
+		CubeCoord mine = CellToCube(cell);
+
+		for (int center = 0; center < MAP_SIZE; center++)
+		{
+			if (ComputeDistance(mine, CellToCube(center)) > 2)
+				continue;
+
+			for (int rotation = 0; rotation < 6; rotation++)
+			{
+				int pose = ToPose(center, rotation);
+				int cells[3] =
+				{ center, KINEMATICS.GetBow(pose), KINEMATICS.GetStern(pose) };
+				int minDistance = 2;
+
+				for (int c = 0; c < 3; c++)
+				{
+					if (cells[c] >= 0)
+						minDistance = min(minDistance, ComputeDistance(mine, CellToCube(cells[c])));
+				}
+
+				// a ship on the mine takes the cannonball instead
+				if (minDistance == 1)
+					_splashDamage[turn][pose] += probability * NEAR_MINE_DAMAGE;
+			}
+		}
+	}
+public:
+	void Build(const EntityTracker& tracker, const vector<OffsetCoord>& mines, const vector<Ship>& myShips)
+	{
+		fill(&_centerDamage[0][0], &_centerDamage[0][0] + (DANGER_HORIZON + 1) * MAP_SIZE, 0.f);
+		fill(&_hullDamage[0][0], &_hullDamage[0][0] + (DANGER_HORIZON + 1) * MAP_SIZE, 0.f);
+		fill(&_splashDamage[0][0], &_splashDamage[0][0] + (DANGER_HORIZON + 1) * POSE_COUNT, 0.f);
+
+		ArenaVector<bool> isMine(MAP_SIZE, false);
+
+		for (unsigned int i = 0; i < mines.size(); i++)
+		{
+			int cell = OffsetToIndex(mines[i]);
+			isMine[cell] = true;
+
+			for (int turn = 1; turn <= DANGER_HORIZON; turn++)
+			{
+				_centerDamage[turn][cell] += MINE_DAMAGE;
+				_hullDamage[turn][cell] += MINE_DAMAGE;
+			}
+		}
+
+		const vector<Cannonball>& cannonballs = tracker.GetCannonballs();
+
+		for (unsigned int i = 0; i < cannonballs.size(); i++)
+		{
+			int turn = cannonballs[i].remainingTurns;
+
+			if (turn >= 1 && turn <= DANGER_HORIZON)
+				AddImpact(turn, OffsetToIndex(cannonballs[i].target), 1, isMine);
+		}
+
+		const vector<Ship>& enemyShips = tracker.GetEnemyShips();
+
+		for (unsigned int i = 0; i < enemyShips.size(); i++)
+		{
+			if (!tracker.CanFire(enemyShips[i].GetEntityId()))
+				continue;
+
+			CubeCoord enemyBow = OffsetToCube(enemyShips[i].GetFrontPos());
+
+			for (unsigned int j = 0; j < myShips.size(); j++)
+			{
+				const Ship& ship = myShips[j];
+
+				for (int turn = 1; turn <= MAX_FIRING_RANGE; turn++)
+				{
+					OffsetCoord straight = CubeToOffset(ship.GetCenterPosCube() + DIRECTIONS[ship.GetRotation()] * (turn * ship.GetSpeed()));
+
+					if (!IsInsideMap(straight))
+						break;
+
+					int distance = ComputeDistance(enemyBow, OffsetToCube(straight));
+
+					if (distance <= FIRE_DISTANCE_MAX && ComputeTravelTime(distance) == turn)
+						AddImpact(turn, OffsetToIndex(straight), LIKELY_FIRE_PROBABILITY, isMine);
+				}
+			}
+		}
+	}
+	/**
+	 * Expected damage of a ship state the given number of moves from now.
+	 */
+	float GetDamage(int turn, int state) const
+	{
+		turn = min(turn, DANGER_HORIZON);
+		int pose = StatePose(state);
+		int bow = KINEMATICS.GetBow(pose);
+		int stern = KINEMATICS.GetStern(pose);
+
+		return _centerDamage[turn][StateCell(state)] + ((bow >= 0) ? _hullDamage[turn][bow] : 0)
+				+ ((stern >= 0) ? _hullDamage[turn][stern] : 0) + _splashDamage[turn][pose];
+	}
+};
+
+}
+using namespace danger;
+
+//#############################################################
+//#############################################################
+// NAMESPACE PATHFINDER
+//#############################################################
+//#############################################################
+
+namespace pathfinder
+{
+
+// damage a turn of travel is worth
+const int TURN_COST = 10;
+
+// longer paths are not kept by PathPlanner
+const int MAX_PLAN_LENGTH = 64;
+// of the time left, for repairing a plan from its valid moves, so the full search after a failed repair still has a budget
+const double REPAIR_TIME_SHARE = 0.5;
+
+// entries of the transposition table of FindPath
+const int TRANSPOSITION_BITS = 14;
+
+class Action
+{
+// VARIABLES
+private:
+	int _turn = 0;
+protected:
+	Ship _shipState;
+	int _heuristic = 0;
+	int _damage = 0;
+
+// CONSTRUCTORS
+protected:
+	Action(Action* previousAction)
+	{
+		if (previousAction != nullptr)
+		{
+			_turn = previousAction->_turn + 1;
+			_damage = previousAction->_damage;
+		}
+	}
+public:
+	Action()
+	{
+	}
+	Action(const Action& action)
+	{
+		_turn = action._turn;
+		_shipState = Ship(action._shipState);
+		_heuristic = action._heuristic;
+		_damage = action._damage;
+	}
+	virtual ~Action()
+	{
+	}
+
+// FUNCTIONS
+protected:
+	void ComputeMove()
+	{
+		if (_shipState.GetSpeed() > 0)
+		{
+			OffsetCoord newPos = CubeToOffset(
+					_shipState.GetCenterPosCube() + (DIRECTIONS[_shipState.GetRotation()] * _shipState.GetSpeed()));
+			_shipState.SetPos(newPos);
+		}
+	}
+	void ComputeDamage(const DangerMap* dangerMap)
+	{
+		if (dangerMap != nullptr && IsInsideMap(_shipState.GetCenterPosOffset()) && IsInsideMap(_shipState.GetFrontPos())
+				&& IsInsideMap(_shipState.GetBackPos()))
+			_damage += (int) dangerMap->GetDamage(_turn + 1, ToState(_shipState));
+	}
+	void ComputeHeuristic(const DistanceField* distanceField)
+	{
+		if (distanceField == nullptr)
+			_heuristic = 0;
+		else if (!IsInsideMap(_shipState.GetCenterPosOffset()))
+			_heuristic = UNREACHABLE;
+		else
+			_heuristic = distanceField->at(ToState(_shipState));
+	}
+public:
+	/**
+	 * Every turn costs TURN_COST, expected damage is added as it is, so paths trade a little time for a lot less damage.
+	 */
+	int GetTotalCost()
+	{
+		return (_turn + _heuristic) * TURN_COST + _damage;
+	}
+	int GetTurn() const
+	{
+		return _turn;
+	}
+	int GetHeuristic() const
+	{
+		return _heuristic;
+	}
+	int GetDamage() const
+	{
+		return _damage;
+	}
+	Ship GetShipState() const
+	{
+		return _shipState;
+	}
+	bool IsLegal(const vector<string>* obstacleMap) const
+	{
+		return _shipState.IsShipPositionLegal(obstacleMap, _turn);
+	}
+	virtual int GetMove() const=0;
+};
+
+class WaitAction: public Action
+{
+public:
+	WaitAction(const Ship& initialState, Action* previousAction, const DistanceField* distanceField,
+			const DangerMap* dangerMap) :
+			Action(previousAction)
+	{
+		_shipState = Ship(initialState);
+
+		ComputeMove();
+		ComputeDamage(dangerMap);
+		ComputeHeuristic(distanceField);
+	}
+	int GetMove() const
+	{
+		return MOVE_WAIT;
+	}
+};
+
+class PortAction: public Action
+{
+public:
+	PortAction(const Ship& initialState, Action* previousAction, const DistanceField* distanceField,
+			const DangerMap* dangerMap) :
+			Action(previousAction)
+	{
+		_shipState = Ship(initialState);
+
+		ComputeMove();
+
+		_shipState.SetRotation(RoundDirection(_shipState.GetRotation() + 1));
+
+		ComputeDamage(dangerMap);
+		ComputeHeuristic(distanceField);
+	}
+	int GetMove() const
+	{
+		return MOVE_PORT;
+	}
+};
+
+class StarboardAction: public Action
+{
+public:
+	StarboardAction(const Ship& initialState, Action* previousAction, const DistanceField* distanceField,
+			const DangerMap* dangerMap) :
+			Action(previousAction)
+	{
+		_shipState = Ship(initialState);
+
+		ComputeMove();
+
+		_shipState.SetRotation(RoundDirection(_shipState.GetRotation() - 1));
+		ComputeDamage(dangerMap);
+		ComputeHeuristic(distanceField);
+	}
+	int GetMove() const
+	{
+		return MOVE_STARBOARD;
+	}
+};
+
+class FasterAction: public Action
+{
+public:
+	FasterAction(const Ship& initialState, Action* previousAction, const DistanceField* distanceField,
+			const DangerMap* dangerMap) :
+			Action(previousAction)
+	{
+		_shipState = Ship(initialState);
+
+		if (_shipState.GetSpeed() < 2)
+			_shipState.SetSpeed(_shipState.GetSpeed() + 1);
+
+		ComputeMove();
+		ComputeDamage(dangerMap);
+		ComputeHeuristic(distanceField);
+	}
+	int GetMove() const
+	{
+		return MOVE_FASTER;
+	}
+};
+
+class SlowerAction: public Action
+{
+public:
+	SlowerAction(const Ship& initialState, Action* previousAction, const DistanceField* distanceField,
+			const DangerMap* dangerMap) :
+			Action(previousAction)
+	{
+		_shipState = Ship(initialState);
+
+		if (_shipState.GetSpeed() > 0)
+			_shipState.SetSpeed(_shipState.GetSpeed() - 1);
+
+		ComputeMove();
+		ComputeDamage(dangerMap);
+		ComputeHeuristic(distanceField);
+	}
+	int GetMove() const
+	{
+		return MOVE_SLOWER;
+	}
+};
+
+template<typename T, typename priority_t>
+class PriorityQueue
+{
+	typedef pair<priority_t, T> element;
+
+	struct PriorityCompare
+	{
+		bool operator()(const element& lhs, const element& rhs)
+		{
+			return lhs.first > rhs.first;
+		}
+	};
+
+public:
+	inline bool Empty() const
+	{
+		return elements.empty();
+	}
+
+	inline void Push(T item, priority_t priority)
+	{
+		elements.emplace(priority, item);
+	}
+
+	inline T Pop()
+	{
+		T item = elements.top().second;
+		elements.pop();
+		return item;
+		/*element e = elements.top();
+		 priority_t p = e.first;
+		 item = e.second;
+		 elements.pop();
+		 return p;*/
+	}
+
+private:
+	priority_queue<element, ArenaVector<element>, PriorityCompare> elements;
+};
+
+/**
+ * Node of FindPath, 8 bytes where an Action holds a whole Ship: the ship is its state index and the command a Move. The
+ * first move of a path is found by walking back the parents once the search is over.
+ */
+struct PathNode
+{
+	int parent :24; // node it was expanded from, -1 for the first moves
+	unsigned int turn :8;
+	unsigned int state :14;
+	unsigned int move :3;
+	unsigned int damage :15; // expected damage since the start, saturated
+};
+
+static_assert(STATE_COUNT <= 1 << 14, "a ship state must fit in a PathNode");
+static_assert(sizeof(PathNode) == 8, "PathNode must stay packed");
+
+const int MAX_NODE_TURN = (1 << 8) - 1;
+const int MAX_NODE_DAMAGE = (1 << 15) - 1;
+
+/**
+ * First move of the path ending at the node.
+ */
+int GetFirstMove(const ArenaVector<PathNode>& nodes, int node)
+{
+	while (nodes[node].parent >= 0)
+		node = nodes[node].parent;
+
+	return nodes[node].move;
+}
+
+/**
+ * Cheapest cost found by the current search for each state, so that a state is only queued and expanded again when it is
+ * reached for less. The table is hashed and small: a collision only costs a duplicate expansion.
+ */
+class TranspositionTable
+{
+// VARIABLES
+private:
+	struct Entry
+	{
+		unsigned int key = 0;
+		int cost = 0;
+	};
+
+	Entry _entries[1 << TRANSPOSITION_BITS];
+	unsigned int _generation = 0;
+
+// FUNCTIONS
+private:
+	static unsigned int Hash(unsigned int key)
+	{
+		return (key * 2654435761u) >> (32 - TRANSPOSITION_BITS);
+	}
+public:
+	/**
+	 * Starts a search: the entries of the previous ones no longer match any key.
+	 */
+	void Clear()
+	{
+		_generation = (_generation + 1) & 0xFF;
+
+		if (_generation == 0)
+		{
+			fill(_entries, _entries + (1 << TRANSPOSITION_BITS), Entry());
+			_generation = 1;
+		}
+	}
+	/**
+	 * The damage of a state only depends on the turn up to the danger horizon and the other ships only block the first
+	 * turns, so all later turns share a key.
+	 */
+	unsigned int ToKey(int state, int turn) const
+	{
+		return state | min(turn, DANGER_HORIZON - 1) << 16 | _generation << 24;
+	}
+	/**
+	 * Records the cost unless the key was already reached for as little.
+	 */
+	bool Update(unsigned int key, int cost)
+	{
+		Entry& entry = _entries[Hash(key)];
+
+		if (entry.key == key && entry.cost <= cost)
+			return false;
+
+		entry.key = key;
+		entry.cost = cost;
+		return true;
+	}
+	/**
+	 * Whether the key was reached for less since a node with this cost was queued.
+	 */
+	bool IsSuperseded(unsigned int key, int cost) const
+	{
+		const Entry& entry = _entries[Hash(key)];
+		return entry.key == key && entry.cost < cost;
+	}
+};
+
+TranspositionTable TRANSPOSITIONS;
+
+/**
+ * Queues the successors of a node, or of the start state when parent is -1. They are checked as one batch first, so that
+ * only the legal ones that can still reach the destination, and were not reached for less already, become nodes.
+ */
+void ExpandNode(int state, int parent, int turn, int shipId, const DistanceFieldCache* distanceFields,
+		const DistanceField* distanceField, const DangerMap* dangerMap, ArenaVector<PathNode>& nodes,
+		PriorityQueue<int, int>& queue)
+{
+	if (turn > MAX_NODE_TURN)
+		return;
+
+	int damage = (parent >= 0) ? nodes[parent].damage : 0;
+
+	StateBatch batch;
+	KINEMATICS.ExpandBatch(&state, 1, batch);
+	distanceFields->EvaluateBatch(batch, distanceField, shipId, turn);
+
+	for (int i = 0; i < batch.count; i++)
+	{
+		// states that cannot reach the destination any more are not worth queueing
+		if (!batch.legal[i] || batch.heuristics[i] == UNREACHABLE)
+			continue;
+
+		int next = batch.states[i];
+		int nextDamage = damage + ((dangerMap != nullptr) ? (int) dangerMap->GetDamage(turn + 1, next) : 0);
+		nextDamage = min(nextDamage, MAX_NODE_DAMAGE);
+
+		if (!TRANSPOSITIONS.Update(TRANSPOSITIONS.ToKey(next, turn), turn * TURN_COST + nextDamage))
+			continue;
+
+		PathNode node;
+		node.parent = parent;
+		node.state = next;
+		node.damage = nextDamage;
+		node.turn = turn;
+		node.move = batch.moves[i];
+
+		nodes.push_back(node);
+		queue.Push(nodes.size() - 1, (turn + batch.heuristics[i]) * TURN_COST + nextDamage);
+	}
+}
+
+/**
+ * Counters of one search, filled in for the benchmark.
+ */
+struct SearchStats
+{
+	int expandedNodes = 0;
+	int generatedNodes = 0;
+	int pathLength = -1; // turns of the returned path
+	int pathCost = -1; // total cost of the returned path
+};
+
+/**
+ * A* from the ship to the destination (reached when the bow is on it), the ship being at the given turn of the path.
+ * Every turn costs TURN_COST and expected damage is added as it is, so paths trade a little time for a lot less damage.
+ * Returns the node that reached the destination, or if the deadline passed first the one closest to it (reached is then
+ * false), or -1 if the ship cannot move at all.
+ */
+int SearchPath(const Ship& ship, int startTurn, const DistanceFieldCache* distanceFields, const DistanceField* distanceField,
+		const DangerMap* dangerMap, const OffsetCoord destination, double deadline, ArenaVector<PathNode>& nodes, bool& reached,
+		SearchStats* stats)
+{
+	int destinationCell = OffsetToIndex(destination);
+	PriorityQueue<int, int> queue;
+
+	TRANSPOSITIONS.Clear();
+	ExpandNode(ToState(ship), -1, startTurn, ship.GetEntityId(), distanceFields, distanceField, dangerMap, nodes, queue);
+
+	int lastNode = -1;
+	int bestNode = -1;
+	int bestHeuristic = UNREACHABLE;
+	int expandedNodes = 0;
+
+	while (!queue.Empty())
+	{
+		int current = queue.Pop();
+		PathNode node = nodes[current];
+
+		// a cheaper way to the same state was queued after this one
+		if (TRANSPOSITIONS.IsSuperseded(TRANSPOSITIONS.ToKey(node.state, node.turn), node.turn * TURN_COST + node.damage))
+			continue;
+
+		int heuristic = (*distanceField)[node.state];
+
+		if (bestNode < 0 || heuristic < bestHeuristic)
+		{
+			bestNode = current;
+			bestHeuristic = heuristic;
+		}
+
+		if (KINEMATICS.GetBow(StatePose(node.state)) == destinationCell)
+		{
+			lastNode = current;
+			break;
+		}
+
+		if (IsPast(deadline))
+			break;
+
+		ExpandNode(node.state, current, node.turn + 1, ship.GetEntityId(), distanceFields, distanceField, dangerMap, nodes,
+				queue);
+		expandedNodes++;
+	}
+
+	int pathEnd = (lastNode >= 0) ? lastNode : bestNode;
+	reached = lastNode >= 0;
+
+	if (stats != nullptr)
+	{
+		stats->expandedNodes = expandedNodes;
+		stats->generatedNodes = nodes.size();
+		stats->pathLength = (pathEnd >= 0) ? nodes[pathEnd].turn + 1 - startTurn : -1;
+		stats->pathCost =
+				(pathEnd >= 0) ? (nodes[pathEnd].turn + (*distanceField)[nodes[pathEnd].state]) * TURN_COST + nodes[pathEnd].damage : -1;
+	}
+
+	return pathEnd;
+}
+
+/**
+ * A* from the ship to the destination. The search is anytime: if the deadline passes before the destination is reached,
+ * the first move of the node closest to the destination is returned.
+ *
+ * returns 1 if a full path was found, 0 if only a partial one and -1 if the ship cannot move at all
+ */
+int FindPath(const Ship& ship, DistanceFieldCache* distanceFields, const DangerMap* dangerMap, const OffsetCoord destination,
+		double deadline, int& move, SearchStats* stats = nullptr)
+{
+	const DistanceField* distanceField = distanceFields->Get(destination);
+
+	if (distanceField == nullptr || distanceField->at(ToState(ship)) == UNREACHABLE)
+	{
+		cerr << "FindPath failed! destination unreachable" << endl;
+		return -1;
+	}
+
+	bool reached = false;
+	SearchStats searchStats;
+	ArenaVector<PathNode> nodes;
+	int pathEnd = SearchPath(ship, 0, distanceFields, distanceField, dangerMap, destination, deadline, nodes, reached,
+			&searchStats);
+
+	if (stats != nullptr)
+		*stats = searchStats;
+
+	if (pathEnd < 0)
+	{
+		cerr << "FindPath failed!" << endl;
+		return -1;
+	}
+
+	move = GetFirstMove(nodes, pathEnd);
+	cerr << (reached ? "FindPath successfull! nodes=" : "FindPath partial! nodes=") << searchStats.generatedNodes << endl;
+
+	return reached ? 1 : 0;
+}
+
+/**
+ * Full path to a destination, kept from one turn to the next.
+ */
+struct PathPlan
+{
+	int shipId;
+	int destinationCell;
+	int state; // state the ship should be in when the plan is next used
+	int length;
+	int moves[MAX_PLAN_LENGTH];
+	int damages[MAX_PLAN_LENGTH]; // expected damage of each move
+	bool used;
+};
+
+/**
+ * FindPath with the paths of the previous turns kept: a plan is checked move by move against the new mines, ships and
+ * danger, and searched again only from its first move that became illegal or more dangerous. Plans that were not asked
+ * for during a turn are dropped.
+ */
+class PathPlanner
+{
+// VARIABLES
+private:
+	vector<PathPlan> _plans;
+
+// FUNCTIONS
+private:
+	PathPlan* GetPlan(int shipId, int destinationCell)
+	{
+		for (unsigned int i = 0; i < _plans.size(); i++)
+		{
+			if (_plans[i].shipId == shipId && _plans[i].destinationCell == destinationCell)
+				return &_plans[i];
+		}
+
+		PathPlan plan;
+		plan.shipId = shipId;
+		plan.destinationCell = destinationCell;
+		plan.state = -1;
+		plan.length = 0;
+		_plans.push_back(plan);
+
+		return &_plans.back();
+	}
+	/**
+	 * Number of moves of the plan that are still legal and not more dangerous than planned.
+	 */
+	int ValidatePlan(PathPlan& plan, const DistanceFieldCache* distanceFields, const DangerMap* dangerMap) const
+	{
+		int state = plan.state;
+
+		for (int i = 0; i < plan.length; i++)
+		{
+			state = KINEMATICS.GetSuccessor(state, plan.moves[i]);
+
+			if (state < 0 || !distanceFields->IsStateLegal(state, plan.shipId, i))
+				return i;
+
+			int damage = (dangerMap != nullptr) ? (int) dangerMap->GetDamage(i + 1, state) : 0;
+
+			if (damage > plan.damages[i])
+				return i;
+
+			plan.damages[i] = damage;
+		}
+
+		return plan.length;
+	}
+	/**
+	 * Replaces the moves of the plan after its valid ones by the path ending at pathEnd, which was searched from there.
+	 */
+	bool SplicePlan(PathPlan& plan, const ArenaVector<PathNode>& nodes, int pathEnd) const
+	{
+		int length = nodes[pathEnd].turn + 1;
+
+		if (length > MAX_PLAN_LENGTH)
+			return false;
+
+		for (int i = pathEnd; i >= 0; i = nodes[i].parent)
+		{
+			const PathNode& node = nodes[i];
+
+			plan.moves[node.turn] = node.move;
+			plan.damages[node.turn] = node.damage - ((node.parent >= 0) ? nodes[node.parent].damage : 0);
+		}
+
+		plan.length = length;
+		return true;
+	}
+	void FillStats(const PathPlan& plan, SearchStats* stats) const
+	{
+		if (stats == nullptr)
+			return;
+
+		stats->pathLength = plan.length;
+		stats->pathCost = (plan.length - 1) * TURN_COST;
+
+		for (int i = 0; i < plan.length; i++)
+			stats->pathCost += plan.damages[i];
+	}
+public:
+	void BeginTurn()
+	{
+		unsigned int kept = 0;
+
+		for (unsigned int i = 0; i < _plans.size(); i++)
+		{
+			if (_plans[i].used)
+			{
+				_plans[kept] = _plans[i];
+				_plans[kept].used = false;
+				kept++;
+			}
+		}
+
+		_plans.resize(kept);
+	}
+	/**
+	 * Same contract as FindPath.
+	 */
+	int FindPath(const Ship& ship, DistanceFieldCache* distanceFields, const DangerMap* dangerMap, const OffsetCoord destination,
+			double deadline, int& move, SearchStats* stats = nullptr)
+	{
+		const DistanceField* distanceField = distanceFields->Get(destination);
+		int state = ToState(ship);
+
+		if (distanceField == nullptr || (*distanceField)[state] == UNREACHABLE)
+		{
+			cerr << "FindPath failed! destination unreachable" << endl;
+			return -1;
+		}
+
+		PathPlan* plan = GetPlan(ship.GetEntityId(), OffsetToIndex(destination));
+		plan->used = true;
+
+		if (plan->state != state)
+			plan->length = 0;
+
+		plan->state = state;
+		int validMoves = ValidatePlan(*plan, distanceFields, dangerMap);
+		SearchStats searchStats;
+
+		if (plan->length == 0 || validMoves < plan->length)
+		{
+			// the search starts where the valid part of the plan ends
+			Ship start = Ship(ship);
+			int startState = state;
+
+			for (int i = 0; i < validMoves; i++)
+				startState = KINEMATICS.GetSuccessor(startState, plan->moves[i]);
+
+			start.SetPos(OffsetCoord(StateCell(startState) % MAP_WIDTH, StateCell(startState) / MAP_WIDTH));
+			start.SetRotation(StateRotation(startState));
+			start.SetSpeed(StateSpeed(startState));
+
+			bool reached = false;
+			ArenaVector<PathNode> nodes;
+			double searchDeadline = (validMoves > 0) ? Now() + (deadline - Now()) * REPAIR_TIME_SHARE : deadline;
+			int pathEnd = SearchPath(start, validMoves, distanceFields, distanceField, dangerMap, destination, searchDeadline,
+					nodes, reached, &searchStats);
+
+			if (!reached && validMoves > 0)
+			{
+				validMoves = 0;
+				nodes.clear();
+				pathEnd = SearchPath(ship, 0, distanceFields, distanceField, dangerMap, destination, deadline, nodes, reached,
+						&searchStats);
+			}
+
+			if (stats != nullptr)
+				*stats = searchStats;
+
+			if (pathEnd < 0)
+			{
+				plan->length = 0;
+				cerr << "FindPath failed!" << endl;
+				return -1;
+			}
+
+			if (!reached || !SplicePlan(*plan, nodes, pathEnd))
+			{
+				move = (validMoves > 0) ? plan->moves[0] : GetFirstMove(nodes, pathEnd);
+				plan->length = 0;
+				cerr << (reached ? "FindPath successfull! nodes=" : "FindPath partial! nodes=") << searchStats.generatedNodes
+						<< endl;
+				return reached ? 1 : 0;
+			}
+
+			cerr << "FindPath replanned from move " << validMoves << endl;
+		}
+		else
+			cerr << "FindPath reused plan" << endl;
+
+		FillStats(*plan, stats);
+		move = plan->moves[0];
+
+		// the plan now starts at the next turn
+		plan->state = KINEMATICS.GetSuccessor(state, plan->moves[0]);
+		plan->length--;
+		copy(plan->moves + 1, plan->moves + 1 + plan->length, plan->moves);
+		copy(plan->damages + 1, plan->damages + 1 + plan->length, plan->damages);
+
+		return 1;
+	}
+};
+
+}
+using namespace pathfinder;
+
+//#############################################################
+//#############################################################
+// NAMESPACE FIRING
+//#############################################################
+//#############################################################
+
+namespace firing
+{
+
+//=============================================================
+// CONSTANTS
+//=============================================================
+
+// expected damage below which a shot is not worth giving up a move
+const float MIN_FIRING_DAMAGE = 12;
+
+//=============================================================
+// STRUCTS
+//=============================================================
+
+/**
+ * Probability of the enemy ships occupying each cell in the next MAX_FIRING_RANGE turns. Every enemy is simulated with
+ * the kinematics tables over all of its move sequences, weighted by its recent motion; moves that would leave the map or
+ * hit a mine are dropped.
+ */
+class EnemyForecast
+{
+	// VARIABLES
+private:
+	float _centers[MAX_FIRING_RANGE + 1][MAP_SIZE];
+	float _hulls[MAX_FIRING_RANGE + 1][MAP_SIZE];
+	float _poses[MAX_FIRING_RANGE + 1][POSE_COUNT];
+
+	vector<int> _touchedCells[MAX_FIRING_RANGE + 1];
+	vector<int> _touchedPoses[MAX_FIRING_RANGE + 1];
+
+	// CONSTRUCTORS
+public:
+	EnemyForecast()
+	{
+		fill(&_centers[0][0], &_centers[0][0] + (MAX_FIRING_RANGE + 1) * MAP_SIZE, 0.f);
+		fill(&_hulls[0][0], &_hulls[0][0] + (MAX_FIRING_RANGE + 1) * MAP_SIZE, 0.f);
+		fill(&_poses[0][0], &_poses[0][0] + (MAX_FIRING_RANGE + 1) * POSE_COUNT, 0.f);
+	}
+
+	// FUNCTIONS
+private:
+	void AddCell(int turn, int cell, float probability, float (*cells)[MAP_SIZE])
+	{
+		if (cell < 0)
+			return;
+
+		if (_centers[turn][cell] == 0 && _hulls[turn][cell] == 0)
+			_touchedCells[turn].push_back(cell);
+
+		cells[turn][cell] += probability;
+	}
+	void Propagate(int state, float probability, int turn, const float* moveWeights, const DistanceFieldCache& distanceFields)
+	{
+		if (turn > 0)
+		{
+			int pose = StatePose(state);
+
+			if (_poses[turn][pose] == 0)
+				_touchedPoses[turn].push_back(pose);
+
+			_poses[turn][pose] += probability;
+			AddCell(turn, StateCell(state), probability, _centers);
+			AddCell(turn, KINEMATICS.GetBow(pose), probability, _hulls);
+			AddCell(turn, KINEMATICS.GetStern(pose), probability, _hulls);
+		}
+
+		if (turn == MAX_FIRING_RANGE)
+			return;
+
+		int nextStates[MOVE_COUNT];
+		float totalWeight = 0;
+
+		for (int move = 0; move < MOVE_COUNT; move++)
+		{
+			nextStates[move] = KINEMATICS.ApplyMove(state, move);
+
+			if (nextStates[move] >= 0 && distanceFields.IsLegal(StatePose(nextStates[move])))
+				totalWeight += moveWeights[move];
+			else
+				nextStates[move] = -1;
+		}
+
+		// a ship without any legal move is stopped where it is
+		if (totalWeight <= 0)
+		{
+			Propagate(ToState(StateCell(state), StateRotation(state), 0), probability, turn + 1, moveWeights, distanceFields);
+			return;
+		}
+
+		for (int move = 0; move < MOVE_COUNT; move++)
+		{
+			if (nextStates[move] >= 0 && moveWeights[move] > 0)
+				Propagate(nextStates[move], probability * moveWeights[move] / totalWeight, turn + 1, moveWeights, distanceFields);
+		}
+	}
+public:
+	void Predict(const EntityTracker& tracker, const DistanceFieldCache& distanceFields)
+	{
+		for (int turn = 0; turn <= MAX_FIRING_RANGE; turn++)
+		{
+			for (unsigned int i = 0; i < _touchedCells[turn].size(); i++)
+			{
+				_centers[turn][_touchedCells[turn][i]] = 0;
+				_hulls[turn][_touchedCells[turn][i]] = 0;
+			}
+			for (unsigned int i = 0; i < _touchedPoses[turn].size(); i++)
+				_poses[turn][_touchedPoses[turn][i]] = 0;
+
+			_touchedCells[turn].clear();
+			_touchedPoses[turn].clear();
+		}
+
+		const vector<Ship>& enemyShips = tracker.GetEnemyShips();
+		float moveWeights[MOVE_COUNT];
+
+		for (unsigned int i = 0; i < enemyShips.size(); i++)
+		{
+			tracker.GetMoveWeights(enemyShips[i].GetEntityId(), moveWeights);
+			Propagate(ToState(enemyShips[i]), 1, 0, moveWeights, distanceFields);
+		}
+	}
+	/**
+	 * Expected damage of a cannonball landing on the cell after the given number of turns.
+	 */
+	float GetHitDamage(int turn, int cell) const
+	{
+		return HIGH_DAMAGE * _centers[turn][cell] + LOW_DAMAGE * _hulls[turn][cell];
+	}
+	/**
+	 * Expected damage to the enemies next to a mine (but not on it) if it explodes after the given number of turns.
+	 */
+	float GetNearMineDamage(int turn, int mineCell) const
+	{
+		CubeCoord mine = CellToCube(mineCell);
+		float damage = 0;
+
+		for (unsigned int i = 0; i < _touchedPoses[turn].size(); i++)
+		{
+			int pose = _touchedPoses[turn][i];
+			int cells[3] =
+			{ pose / 6, KINEMATICS.GetBow(pose), KINEMATICS.GetStern(pose) };
+			int minDistance = 2;
+
+			for (int c = 0; c < 3; c++)
+			{
+				if (cells[c] >= 0)
+					minDistance = min(minDistance, ComputeDistance(mine, CellToCube(cells[c])));
+			}
+
+			if (minDistance == 1)
+				damage += NEAR_MINE_DAMAGE * _poses[turn][pose];
+		}
+
+		return damage;
+	}
+	/**
+	 * Expected number of enemy ship parts (center, bow or stern) on the cell after the given number of turns.
+	 */
+	float GetOccupancy(int turn, int cell) const
+	{
+		return _centers[turn][cell] + _hulls[turn][cell];
+	}
+	const vector<int>& GetTouchedCells(int turn) const
+	{
+		return _touchedCells[turn];
+	}
+};
+
+/**
+ * Picks the best target for a ship: any cell the enemies may occupy, or a mine next to them, scored by expected damage.
+ * returns the expected damage, 0 if there is nothing to shoot at
+ */
+float SolveFiring(const Ship& ship, const EnemyForecast& forecast, const vector<OffsetCoord>& mines, const vector<Ship>& myShips,
+		OffsetCoord& target)
+{
+	CubeCoord bow = OffsetToCube(ship.GetFrontPos());
+	float bestDamage = 0;
+
+	for (int turn = 1; turn <= MAX_FIRING_RANGE; turn++)
+	{
+		const vector<int>& cells = forecast.GetTouchedCells(turn);
+
+		for (unsigned int i = 0; i < cells.size(); i++)
+		{
+			int distance = ComputeDistance(bow, CellToCube(cells[i]));
+
+			if (distance > FIRE_DISTANCE_MAX || ComputeTravelTime(distance) != turn)
+				continue;
+
+			float damage = forecast.GetHitDamage(turn, cells[i]);
+
+			if (damage > bestDamage)
+			{
+				bestDamage = damage;
+				target = OffsetCoord(cells[i] % MAP_WIDTH, cells[i] / MAP_WIDTH);
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < mines.size(); i++)
+	{
+		CubeCoord mine = OffsetToCube(mines[i]);
+		int distance = ComputeDistance(bow, mine);
+
+		if (distance > FIRE_DISTANCE_MAX)
+			continue;
+
+		int turn = ComputeTravelTime(distance);
+		int mineCell = OffsetToIndex(mines[i]);
+		float damage = forecast.GetHitDamage(turn, mineCell) + forecast.GetNearMineDamage(turn, mineCell);
+
+		// our own ships are assumed to stay where they are
+		for (unsigned int j = 0; j < myShips.size(); j++)
+		{
+			if (ComputeDistance(mine, myShips[j].GetCenterPosCube()) <= 2)
+				damage -= NEAR_MINE_DAMAGE;
+		}
+
+		if (damage > bestDamage)
+		{
+			bestDamage = damage;
+			target = mines[i];
+		}
+	}
+
+	return bestDamage;
+}
+
+}
+using namespace firing;
+
+//#############################################################
+//#############################################################
+// NAMESPACE MINING
+//#############################################################
+//#############################################################
+
+namespace mining
+{
+
+//=============================================================
+// CONSTANTS
+//=============================================================
+
+// enemies farther than this from the mine cannot reach it within the forecast
+const int MINE_TRAIL_DISTANCE = 2 * MAX_FIRING_RANGE + 1;
+
+// expected damage below which a mine is not worth giving up a move
+const float MIN_MINING_DAMAGE = 8;
+
+//=============================================================
+// FUNCTIONS
+//=============================================================
+
+/**
+ * Scores dropping a mine behind the ship this turn with the enemy forecast: the expected damage is the chance that an
+ * enemy ship runs over the cell in the next turns. Returns 0 right away if no enemy is close behind.
+ */
+float SolveMining(const Ship& ship, const EnemyForecast& forecast, const vector<Ship>& myShips, const vector<Ship>& enemyShips,
+		const vector<Barrel>& barrels, const vector<string>* objectMap)
+{
+	if (ship.GetMineCooldown() > 0)
+		return 0;
+
+	OffsetCoord minePos = ship.GetMinePos();
+
+	if (!IsInsideMap(minePos) || objectMap->at(OffsetToIndex(minePos)) != "e")
+		return 0;
+
+	CubeCoord mine = OffsetToCube(minePos);
+	bool enemyTrailing = false;
+
+	for (unsigned int i = 0; i < enemyShips.size() && !enemyTrailing; i++)
+		enemyTrailing = ComputeDistance(mine, enemyShips[i].GetCenterPosCube()) <= MINE_TRAIL_DISTANCE;
+
+	if (!enemyTrailing)
+		return 0;
+
+	for (unsigned int i = 0; i < barrels.size(); i++)
+	{
+		if (barrels[i].offsetPos == minePos)
+			return 0;
+	}
+
+	// our other ships are assumed to keep sailing around here
+	for (unsigned int i = 0; i < myShips.size(); i++)
+	{
+		if (myShips[i].GetEntityId() != ship.GetEntityId() && ComputeDistance(mine, myShips[i].GetCenterPosCube()) <= 2)
+			return 0;
+	}
+
+	int mineCell = OffsetToIndex(minePos);
+	float hitProbability = 0;
+
+	for (int turn = 1; turn <= MAX_FIRING_RANGE; turn++)
+		hitProbability += forecast.GetOccupancy(turn, mineCell);
+
+	return MINE_DAMAGE * min(1.f, hitProbability);
+}
+
+}
+using namespace mining;
+
+//#############################################################
+//#############################################################
+// NAMESPACE ROUTING
+//#############################################################
+//#############################################################
+
+namespace routing
+{
+
+//=============================================================
+// CONSTANTS
+//=============================================================
+
+const int MAX_ROUTING_DEPTH = 30;
+const int MAX_TOUR_LENGTH = 3;
+const int MAX_TOUR_CANDIDATES = 6;
+
+//=============================================================
+// STRUCTS
+//=============================================================
+
+/**
+ * Earliest arrival time of one ship at every barrel, computed with a single BFS over the ship states (every move costs one
+ * turn, so BFS is Dijkstra here). A barrel is reached when the center, bow or stern ends a turn on it.
+ */
+class TravelTimes
+{
+	// VARIABLES
+private:
+	ArenaVector<short> _depth;
+	ArenaVector<char> _firstMove;
+	ArenaVector<int> _openStates;
+
+	ArenaVector<int> _arrivalTimes;
+	ArenaVector<int> _arrivalMoves;
+
+	// FUNCTIONS
+public:
+	void Compute(const Ship& ship, const vector<Barrel>& barrels, const DistanceFieldCache& distanceFields,
+			const DangerMap& dangerMap)
+	{
+		_depth.assign(STATE_COUNT, -1);
+		_firstMove.assign(STATE_COUNT, -1);
+		_arrivalTimes.assign(barrels.size(), -1);
+		_arrivalMoves.assign(barrels.size(), -1);
+		_openStates.clear();
+		_openStates.reserve(STATE_COUNT);
+
+		ArenaVector<int> barrelAt(MAP_SIZE, -1);
+		for (unsigned int i = 0; i < barrels.size(); i++)
+			barrelAt[OffsetToIndex(barrels[i].offsetPos)] = i;
+
+		int startState = ToState(ship);
+		_depth[startState] = 0;
+		_openStates.push_back(startState);
+		unsigned int barrelsFound = 0;
+		StateBatch batch;
+
+		// the open states of a depth are expanded together, in batches
+		for (unsigned int head = 0; head < _openStates.size() && barrelsFound < barrels.size();)
+		{
+			int depth = _depth[_openStates[head]];
+
+			if (depth >= MAX_ROUTING_DEPTH)
+				break;
+
+			unsigned int layerEnd = head;
+			while (layerEnd < _openStates.size() && _depth[_openStates[layerEnd]] == depth)
+				layerEnd++;
+
+			batch.count = 0;
+			int expanded = KINEMATICS.ExpandBatch(&_openStates[head], min<int>(layerEnd - head, MAX_BATCH_SIZE / MOVE_COUNT), batch);
+			distanceFields.EvaluateBatch(batch, nullptr, ship.GetEntityId(), depth);
+
+			for (int i = 0; i < batch.count; i++)
+			{
+				int next = batch.states[i];
+
+				// ships and cannonballs depend on the turn, so they are checked like in the pathfinder
+				if (!batch.legal[i] || _depth[next] >= 0 || dangerMap.GetDamage(depth + 1, next) >= LOW_DAMAGE)
+					continue;
+
+				_depth[next] = depth + 1;
+				_firstMove[next] = (depth == 0) ? batch.moves[i] : _firstMove[_openStates[head + batch.parents[i]]];
+				_openStates.push_back(next);
+
+				int cells[3] =
+				{ batch.cells[i], KINEMATICS.GetBow(batch.poses[i]), KINEMATICS.GetStern(batch.poses[i]) };
+
+				for (int c = 0; c < 3; c++)
+				{
+					int barrelIndex = (cells[c] >= 0) ? barrelAt[cells[c]] : -1;
+
+					if (barrelIndex >= 0 && _arrivalTimes[barrelIndex] < 0)
+					{
+						_arrivalTimes[barrelIndex] = depth + 1;
+						_arrivalMoves[barrelIndex] = _firstMove[next];
+						barrelsFound++;
+					}
+				}
+			}
+
+			head += expanded;
+		}
+	}
+	/**
+	 * returns the number of turns to reach the barrel or -1 if it cannot be reached
+	 */
+	int GetArrivalTime(int barrelIndex) const
+	{
+		return _arrivalTimes[barrelIndex];
+	}
+	int GetArrivalMove(int barrelIndex) const
+	{
+		return _arrivalMoves[barrelIndex];
+	}
+};
+
+struct BarrelRoute
+{
+	int shipId = -1;
+	ArenaVector<int> barrels;
+	int firstMove = -1;
+	double score = 0;
+};
+
+/**
+ * Plans a tour of up to MAX_TOUR_LENGTH barrels per ship and shares the barrels between the ships: the ship with the
+ * best tour claims its barrels first, the others plan again without them.
+ */
+class BarrelRouter
+{
+	// VARIABLES
+private:
+	vector<BarrelRoute> _routes;
+
+	// FUNCTIONS
+private:
+	/**
+	 * Only the first leg is known exactly, the following ones are estimated from the hex distance at full speed.
+	 */
+	static int EstimateTravelTime(const Barrel& from, const Barrel& to)
+	{
+		return max(1, (ComputeDistance(from.cubePos, to.cubePos) + 1) / 2);
+	}
+	static void SearchTour(const vector<Barrel>& barrels, const ArenaVector<int>& candidates, ArenaVector<bool>& used, int rumSpace,
+			int time, int rum, ArenaVector<int>& tour, BarrelRoute& bestRoute)
+	{
+		if (!tour.empty() && (double) rum / time > bestRoute.score)
+		{
+			bestRoute.score = (double) rum / time;
+			bestRoute.barrels = tour;
+		}
+
+		if ((int) tour.size() == MAX_TOUR_LENGTH || rumSpace <= 0)
+			return;
+
+		for (unsigned int i = 0; i < candidates.size(); i++)
+		{
+			int barrelIndex = candidates[i];
+
+			if (used[barrelIndex])
+				continue;
+
+			const Barrel& barrel = barrels[barrelIndex];
+			int gain = min(barrel.amount, rumSpace);
+
+			used[barrelIndex] = true;
+			tour.push_back(barrelIndex);
+			SearchTour(barrels, candidates, used, rumSpace - gain, time + EstimateTravelTime(barrels[tour[tour.size() - 2]], barrel),
+					rum + gain, tour, bestRoute);
+			tour.pop_back();
+			used[barrelIndex] = false;
+		}
+	}
+	static BarrelRoute PlanTour(const Ship& ship, const vector<Barrel>& barrels, const TravelTimes& travelTimes,
+			const ArenaVector<bool>& claimed)
+	{
+		BarrelRoute bestRoute;
+		bestRoute.shipId = ship.GetEntityId();
+
+		ArenaVector<pair<int, int>> reachable;
+		for (unsigned int i = 0; i < barrels.size(); i++)
+		{
+			if (!claimed[i] && travelTimes.GetArrivalTime(i) > 0)
+				reachable.emplace_back(travelTimes.GetArrivalTime(i), i);
+		}
+
+		sort(reachable.begin(), reachable.end());
+
+		ArenaVector<int> candidates;
+		for (unsigned int i = 0; i < reachable.size() && (int) candidates.size() < MAX_TOUR_CANDIDATES; i++)
+			candidates.push_back(reachable[i].second);
+
+		int rumSpace = MAX_SHIP_RUM - ship.GetRum();
+		ArenaVector<bool> used(barrels.size(), false);
+		ArenaVector<int> tour;
+
+		// the first leg uses the exact arrival time, the rest of the tour is explored by SearchTour
+		for (unsigned int i = 0; i < candidates.size(); i++)
+		{
+			int barrelIndex = candidates[i];
+			int gain = min(barrels[barrelIndex].amount, rumSpace);
+
+			used[barrelIndex] = true;
+			tour.push_back(barrelIndex);
+			SearchTour(barrels, candidates, used, rumSpace - gain, travelTimes.GetArrivalTime(barrelIndex), gain, tour, bestRoute);
+			tour.pop_back();
+			used[barrelIndex] = false;
+		}
+
+		if (!bestRoute.barrels.empty())
+			bestRoute.firstMove = travelTimes.GetArrivalMove(bestRoute.barrels[0]);
+
+		return bestRoute;
+	}
+public:
+	void Plan(const vector<Ship>& ships, const vector<Barrel>& barrels, const DistanceFieldCache& distanceFields,
+			const DangerMap& dangerMap)
+	{
+		_routes.clear();
+
+		// the routes and all the search data live in the turn arena
+		ArenaVector<const Ship*> thirstyShips;
+		ArenaVector<TravelTimes> travelTimes;
+		travelTimes.reserve(ships.size());
+
+		for (unsigned int i = 0; i < ships.size(); i++)
+		{
+			if (ships[i].GetRum() > BARREL_RUM_THRESHOLD)
+				continue;
+
+			thirstyShips.push_back(&ships[i]);
+			travelTimes.emplace_back();
+			travelTimes.back().Compute(ships[i], barrels, distanceFields, dangerMap);
+		}
+
+		ArenaVector<bool> claimed(barrels.size(), false);
+		ArenaVector<bool> planned(thirstyShips.size(), false);
+
+		for (unsigned int round = 0; round < thirstyShips.size(); round++)
+		{
+			int bestShip = -1;
+			BarrelRoute bestRoute;
+
+			for (unsigned int i = 0; i < thirstyShips.size(); i++)
+			{
+				if (planned[i])
+					continue;
+
+				BarrelRoute route = PlanTour(*thirstyShips[i], barrels, travelTimes[i], claimed);
+
+				if (!route.barrels.empty() && (bestShip < 0 || route.score > bestRoute.score))
+				{
+					bestShip = i;
+					bestRoute = route;
+				}
+			}
+
+			if (bestShip < 0)
+				break;
+
+			planned[bestShip] = true;
+			for (unsigned int i = 0; i < bestRoute.barrels.size(); i++)
+				claimed[bestRoute.barrels[i]] = true;
+
+			_routes.push_back(bestRoute);
+		}
+	}
+	const BarrelRoute* GetRoute(int shipId) const
+	{
+		for (unsigned int i = 0; i < _routes.size(); i++)
+		{
+			if (_routes[i].shipId == shipId)
+				return &_routes[i];
+		}
+
+		return nullptr;
+	}
+};
+
+}
+using namespace routing;
+
+//#############################################################
+//#############################################################
+// NAMESPACE COMMANDS
+//#############################################################
+//#############################################################
+
+namespace commands
+{
+
+//=============================================================
+// CONSTANTS
+//=============================================================
+
+enum CommandType
+{
+	COMMAND_MOVE, COMMAND_FIRE, COMMAND_MINE
+};
+
+// a turn is at most 3 commands of at most 11 characters
+const int OUTPUT_BUFFER_SIZE = 256;
+
+//=============================================================
+// STRUCTS
+//=============================================================
+
+/**
+ * Command of one ship, written out only when the turn is over.
+ */
+struct Command
+{
+	CommandType type = COMMAND_MOVE;
+	int argument = MOVE_WAIT; // the Move, or the cell a FIRE aims at
+};
+
+//=============================================================
+// FUNCTIONS
+//=============================================================
+
+inline Command MoveCommand(int move)
+{
+	Command command;
+	command.type = COMMAND_MOVE;
+	command.argument = move;
+	return command;
+}
+
+inline Command FireCommand(const OffsetCoord& target)
+{
+	Command command;
+	command.type = COMMAND_FIRE;
+	command.argument = OffsetToIndex(target);
+	return command;
+}
+
+inline Command MineCommand()
+{
+	Command command;
+	command.type = COMMAND_MINE;
+	return command;
+}
+
+//=============================================================
+// CLASSES
+//=============================================================
+
+/**
+ * Commands of the turn, sent with a single write and flush.
+ */
+class CommandOutput
+{
+// VARIABLES
+private:
+	char _buffer[OUTPUT_BUFFER_SIZE];
+	int _length = 0;
+
+// FUNCTIONS
+private:
+	void Append(const char* text)
+	{
+		while (*text != '\0')
+			_buffer[_length++] = *text++;
+	}
+	void Append(int value)
+	{
+		if (value >= 10)
+			Append(value / 10);
+
+		_buffer[_length++] = '0' + value % 10;
+	}
+public:
+	void Add(const Command& command)
+	{
+		switch (command.type)
+		{
+		case COMMAND_MOVE:
+			Append(MOVE_COMMANDS[command.argument]);
+			break;
+		case COMMAND_FIRE:
+			Append("FIRE ");
+			Append(command.argument % MAP_WIDTH);
+			Append(" ");
+			Append(command.argument / MAP_WIDTH);
+			break;
+		case COMMAND_MINE:
+			Append("MINE");
+			break;
+		}
+
+		_buffer[_length++] = '\n';
+	}
+	void Flush(ostream& output)
+	{
+		output.write(_buffer, _length);
+		output.flush();
+		_length = 0;
+	}
+};
+
+}
+using namespace commands;
+
+//#############################################################
+//#############################################################
+// NAMESPACE SIMULATION
+//#############################################################
+//#############################################################
+
+namespace simulation
+{
+
+//=============================================================
+// CONSTANTS
+//=============================================================
+
+const int MAX_SIM_SHIPS = 6;
+const int MAX_SIM_CANNONBALLS = 32;
+const int MAX_SIM_MINES = 64;
+const int MAX_SIM_BARRELS = 64;
+
+// the actions of a ship are the moves followed by these two
+enum SimAction
+{
+	SIM_FIRE = MOVE_COUNT, SIM_MINE, SIM_ACTION_COUNT
+};
+
+// how our own ships are played out: mostly keeping their course, with a random move now and then
+const float OWN_MOVE_WEIGHTS[MOVE_COUNT] =
+{ 0.6f, 0.1f, 0.1f, 0.1f, 0.1f };
+
+//=============================================================
+// FUNCTIONS
+//=============================================================
+
+/**
+ * Neighbour of a cell in a direction, -1 outside of the map.
+ */
+inline int Neighbour(int cell, int direction)
+{
+	return KINEMATICS.GetBow(ToPose(cell, direction));
+}
+
+inline int CellDistance(int a, int b)
+{
+	return ComputeDistance(CellToCube(a), CellToCube(b));
+}
+
+/**
+ * Cells of the map padded by one ring, so a bow or a stern outside of the map still collides like in the referee.
+ */
+inline int PaddedCell(int cell)
+{
+	return cell + 2 * (cell / MAP_WIDTH) + MAP_WIDTH + 3;
+}
+
+inline int PaddedNeighbour(int cell, int direction)
+{
+	OffsetCoord neighbour = CubeToOffset(CellToCube(cell) + DIRECTIONS[direction]);
+	return (neighbour.row + 1) * (MAP_WIDTH + 2) + neighbour.col + 1;
+}
+
+//=============================================================
+// STRUCTS
+//=============================================================
+
+struct SimShip
+{
+	int entityId;
+	int owner; // 0 for us, 1 for the enemy
+	int cell;
+	int rotation;
+	int speed;
+	int rum;
+	int initialRum; // rum at the start of the turn, before it was damaged
+	int cannonCooldown;
+	int mineCooldown;
+	bool alive;
+
+	int action;
+	int target; // cell a FIRE aims at
+	float moveWeights[MOVE_COUNT]; // probabilities of the moves when the ship is played out, the enemies' come from their model
+
+	// during the moves and rotations, the padded cells are only compared between ships
+	int newCell;
+	int newRotation;
+	int newCenter; // padded
+	int newBow; // padded
+	int newStern; // padded
+
+	int Bow() const
+	{
+		return Neighbour(cell, rotation);
+	}
+	int Stern() const
+	{
+		return Neighbour(cell, (rotation + 3) % 6);
+	}
+	// the bow and the stern can be outside of the map, where the referee still measures distances from them
+	CubeCoord BowCube() const
+	{
+		return CellToCube(cell) + DIRECTIONS[rotation];
+	}
+	CubeCoord SternCube() const
+	{
+		return CellToCube(cell) + DIRECTIONS[(rotation + 3) % 6];
+	}
+	bool At(int position) const
+	{
+		return position >= 0 && (position == cell || position == Bow() || position == Stern());
+	}
+	void Damage(int amount)
+	{
+		rum = max(0, rum - amount);
+	}
+	void Heal(int amount)
+	{
+		rum = min(MAX_SHIP_RUM, rum + amount);
+	}
+};
+
+struct SimCannonball
+{
+	int cell;
+	int remainingTurns;
+};
+
+struct SimBarrel
+{
+	int cell;
+	int rum;
+};
+
+/**
+ * Whole game state in fixed-size arrays, so that it can be copied with memcpy, and the rules of the referee to advance it
+ * by one turn. The ships are kept in entity order; sunk ones stay in place with alive false, so their index does not
+ * change during a search.
+ */
+struct GameState
+{
+	int turn = 0; // of the game, from 0
+	int shipCount = 0;
+	int cannonballCount = 0;
+	int mineCount = 0;
+	int barrelCount = 0;
+	int explosionCount = 0;
+
+	SimShip ships[MAX_SIM_SHIPS];
+	SimCannonball cannonballs[MAX_SIM_CANNONBALLS];
+	int mines[MAX_SIM_MINES];
+	SimBarrel barrels[MAX_SIM_BARRELS];
+	int explosions[MAX_SIM_CANNONBALLS];
+
+private:
+	bool IsFree(int position) const
+	{
+		for (int i = 0; i < shipCount; i++)
+		{
+			if (ships[i].alive && ships[i].At(position))
+				return false;
+		}
+		for (int i = 0; i < mineCount; i++)
+		{
+			if (mines[i] == position)
+				return false;
+		}
+		for (int i = 0; i < barrelCount; i++)
+		{
+			if (barrels[i].cell == position)
+				return false;
+		}
+
+		return true;
+	}
+	void ExplodeMine(int position, bool force)
+	{
+		int victim = -1;
+
+		for (int i = 0; i < shipCount; i++)
+		{
+			if (ships[i].alive && ships[i].At(position))
+			{
+				ships[i].Damage(MINE_DAMAGE);
+				victim = i;
+			}
+		}
+
+		if (!force && victim < 0)
+			return;
+
+		CubeCoord mine = CellToCube(position);
+
+		for (int i = 0; i < shipCount; i++)
+		{
+			const SimShip& ship = ships[i];
+
+			if (ship.alive && i != victim
+					&& (ComputeDistance(mine, ship.SternCube()) <= 1 || ComputeDistance(mine, ship.BowCube()) <= 1
+							|| ComputeDistance(mine, CellToCube(ship.cell)) <= 1))
+				ships[i].Damage(NEAR_MINE_DAMAGE);
+		}
+	}
+	/**
+	 * Picks up the barrels under the ship and triggers the mines touched by any ship.
+	 */
+	void CheckCollisions(SimShip& ship)
+	{
+		for (int i = 0; i < barrelCount; i++)
+		{
+			if (ship.At(barrels[i].cell))
+			{
+				ship.Heal(barrels[i].rum);
+				barrels[i--] = barrels[--barrelCount];
+			}
+		}
+
+		for (int i = 0; i < mineCount; i++)
+		{
+			bool touched = false;
+
+			for (int j = 0; j < shipCount && !touched; j++)
+				touched = ships[j].alive && ships[j].At(mines[i]);
+
+			if (touched)
+			{
+				int mine = mines[i];
+				mines[i--] = mines[--mineCount];
+				ExplodeMine(mine, false);
+			}
+		}
+	}
+	void ApplyActions()
+	{
+		for (int i = 0; i < shipCount; i++)
+		{
+			SimShip& ship = ships[i];
+
+			if (!ship.alive)
+				continue;
+
+			if (ship.mineCooldown > 0)
+				ship.mineCooldown--;
+			if (ship.cannonCooldown > 0)
+				ship.cannonCooldown--;
+
+			ship.newRotation = ship.rotation;
+
+			switch (ship.action)
+			{
+			case MOVE_FASTER:
+				if (ship.speed < MAX_SHIP_SPEED)
+					ship.speed++;
+				break;
+			case MOVE_SLOWER:
+				if (ship.speed > 0)
+					ship.speed--;
+				break;
+			case MOVE_PORT:
+				ship.newRotation = (ship.rotation + 1) % 6;
+				break;
+			case MOVE_STARBOARD:
+				ship.newRotation = (ship.rotation + 5) % 6;
+				break;
+			case SIM_MINE:
+				if (ship.mineCooldown == 0)
+				{
+					int stern = ship.Stern();
+					int target = (stern >= 0) ? Neighbour(stern, (ship.rotation + 3) % 6) : -1;
+
+					if (target >= 0 && IsFree(target) && mineCount < MAX_SIM_MINES)
+					{
+						ship.mineCooldown = COOLDOWN_MINE;
+						mines[mineCount++] = target;
+					}
+				}
+				break;
+			case SIM_FIRE:
+				if (ship.cannonCooldown == 0 && ship.target >= 0 && cannonballCount < MAX_SIM_CANNONBALLS)
+				{
+					int distance = ComputeDistance(ship.BowCube(), CellToCube(ship.target));
+
+					if (distance <= FIRE_DISTANCE_MAX)
+					{
+						cannonballs[cannonballCount++] =
+						{ ship.target, ComputeTravelTime(distance) };
+						ship.cannonCooldown = COOLDOWN_CANNON;
+					}
+				}
+				break;
+			default:
+				break;
+			}
+		}
+	}
+	bool NewBowIntersect(const SimShip& ship, const SimShip& other) const
+	{
+		return ship.newBow == other.newBow || ship.newBow == other.newCenter || ship.newBow == other.newStern;
+	}
+	bool NewPositionsIntersect(const SimShip& ship, const SimShip& other) const
+	{
+		bool sternCollision = ship.newStern == other.newBow || ship.newStern == other.newCenter || ship.newStern == other.newStern;
+		bool centerCollision = ship.newCenter == other.newBow || ship.newCenter == other.newCenter || ship.newCenter == other.newStern;
+		return NewBowIntersect(ship, other) || sternCollision || centerCollision;
+	}
+	void MoveShips()
+	{
+		for (int step = 1; step <= MAX_SHIP_SPEED; step++)
+		{
+			for (int i = 0; i < shipCount; i++)
+			{
+				SimShip& ship = ships[i];
+				ship.newCell = ship.cell;
+				ship.newCenter = PaddedCell(ship.cell);
+				ship.newBow = PaddedNeighbour(ship.cell, ship.rotation);
+				ship.newStern = PaddedNeighbour(ship.cell, (ship.rotation + 3) % 6);
+
+				if (!ship.alive || step > ship.speed)
+					continue;
+
+				int newCell = Neighbour(ship.cell, ship.rotation);
+
+				if (newCell >= 0)
+				{
+					ship.newCell = newCell;
+					ship.newCenter = PaddedCell(newCell);
+					ship.newBow = PaddedNeighbour(newCell, ship.rotation);
+					ship.newStern = PaddedNeighbour(newCell, (ship.rotation + 3) % 6);
+				}
+				else
+				{
+					ship.speed = 0;
+				}
+			}
+
+			// ships whose bow runs into another ship stay where they are, which can cause new collisions
+			for (bool collision = true; collision;)
+			{
+				collision = false;
+				bool collided[MAX_SIM_SHIPS] = { };
+
+				for (int i = 0; i < shipCount; i++)
+				{
+					for (int j = 0; j < shipCount; j++)
+					{
+						if (i != j && ships[i].alive && ships[j].alive && ships[i].newCell != ships[i].cell
+								&& NewBowIntersect(ships[i], ships[j]))
+						{
+							collided[i] = true;
+							break;
+						}
+					}
+				}
+
+				for (int i = 0; i < shipCount; i++)
+				{
+					if (!collided[i])
+						continue;
+
+					SimShip& ship = ships[i];
+					ship.newCell = ship.cell;
+					ship.newCenter = PaddedCell(ship.cell);
+					ship.newBow = PaddedNeighbour(ship.cell, ship.rotation);
+					ship.newStern = PaddedNeighbour(ship.cell, (ship.rotation + 3) % 6);
+					ship.speed = 0;
+					collision = true;
+				}
+			}
+
+			for (int i = 0; i < shipCount; i++)
+			{
+				if (!ships[i].alive)
+					continue;
+
+				ships[i].cell = ships[i].newCell;
+				CheckCollisions(ships[i]);
+			}
+		}
+	}
+	void RotateShips()
+	{
+		for (int i = 0; i < shipCount; i++)
+		{
+			SimShip& ship = ships[i];
+			ship.newCell = ship.cell;
+			ship.newCenter = PaddedCell(ship.cell);
+			ship.newBow = PaddedNeighbour(ship.cell, ship.newRotation);
+			ship.newStern = PaddedNeighbour(ship.cell, (ship.newRotation + 3) % 6);
+		}
+
+		for (bool collision = true; collision;)
+		{
+			collision = false;
+			bool collided[MAX_SIM_SHIPS] = { };
+
+			for (int i = 0; i < shipCount; i++)
+			{
+				for (int j = 0; j < shipCount; j++)
+				{
+					if (i != j && ships[i].alive && ships[j].alive && ships[i].newRotation != ships[i].rotation
+							&& NewPositionsIntersect(ships[i], ships[j]))
+					{
+						collided[i] = true;
+						break;
+					}
+				}
+			}
+
+			for (int i = 0; i < shipCount; i++)
+			{
+				if (!collided[i])
+					continue;
+
+				SimShip& ship = ships[i];
+				ship.newRotation = ship.rotation;
+				ship.newBow = PaddedNeighbour(ship.cell, ship.rotation);
+				ship.newStern = PaddedNeighbour(ship.cell, (ship.rotation + 3) % 6);
+				ship.speed = 0;
+				collision = true;
+			}
+		}
+
+		for (int i = 0; i < shipCount; i++)
+		{
+			if (!ships[i].alive)
+				continue;
+
+			ships[i].rotation = ships[i].newRotation;
+			CheckCollisions(ships[i]);
+		}
+	}
+	void ExplodeCannonballs()
+	{
+		for (int e = 0; e < explosionCount; e++)
+		{
+			int position = explosions[e];
+			bool consumed = false;
+
+			for (int i = 0; i < shipCount && !consumed; i++)
+			{
+				if (!ships[i].alive)
+					continue;
+
+				if (position == ships[i].Bow() || position == ships[i].Stern())
+				{
+					ships[i].Damage(LOW_DAMAGE);
+					consumed = true;
+				}
+				else if (position == ships[i].cell)
+				{
+					ships[i].Damage(HIGH_DAMAGE);
+					consumed = true;
+				}
+			}
+
+			for (int i = 0; i < mineCount && !consumed; i++)
+			{
+				if (mines[i] == position)
+				{
+					mines[i] = mines[--mineCount];
+					ExplodeMine(position, true);
+					consumed = true;
+				}
+			}
+
+			for (int i = 0; i < barrelCount && !consumed; i++)
+			{
+				if (barrels[i].cell == position)
+				{
+					barrels[i] = barrels[--barrelCount];
+					consumed = true;
+				}
+			}
+		}
+
+		explosionCount = 0;
+	}
+public:
+	/**
+	 * Cell where a cannonball fired now by the ship would hit the other ship, assuming it keeps its course, or -1 when it is
+	 * out of range.
+	 */
+	int GetFireTarget(int shipIndex, int targetIndex) const
+	{
+		const SimShip& other = ships[targetIndex];
+		CubeCoord bow = ships[shipIndex].BowCube();
+
+		// the travel time depends on where the target is, a couple of passes settle it
+		int target = other.cell;
+
+		for (int pass = 0; pass < 2; pass++)
+		{
+			int turns = ComputeTravelTime(ComputeDistance(bow, CellToCube(target)));
+			target = other.cell;
+
+			for (int step = 0; step < other.speed * turns; step++)
+			{
+				int next = Neighbour(target, other.rotation);
+
+				if (next < 0)
+					break;
+
+				target = next;
+			}
+		}
+
+		return (ComputeDistance(bow, CellToCube(target)) <= FIRE_DISTANCE_MAX) ? target : -1;
+	}
+	/**
+	 * Cell where a cannonball fired now by the ship would hit the nearest enemy, or -1.
+	 */
+	int GetFireTarget(int shipIndex) const
+	{
+		const SimShip& ship = ships[shipIndex];
+		CubeCoord bow = ship.BowCube();
+		int bestTarget = -1;
+		int bestDistance = FIRE_DISTANCE_MAX + 1;
+
+		for (int i = 0; i < shipCount; i++)
+		{
+			if (!ships[i].alive || ships[i].owner == ship.owner)
+				continue;
+
+			int target = GetFireTarget(shipIndex, i);
+
+			if (target >= 0 && ComputeDistance(bow, CellToCube(target)) < bestDistance)
+			{
+				bestDistance = ComputeDistance(bow, CellToCube(target));
+				bestTarget = target;
+			}
+		}
+
+		return bestTarget;
+	}
+	int GetRum(int owner) const
+	{
+		int rum = 0;
+
+		for (int i = 0; i < shipCount; i++)
+		{
+			if (ships[i].alive && ships[i].owner == owner)
+				rum += ships[i].rum;
+		}
+
+		return rum;
+	}
+	int GetShipCount(int owner) const
+	{
+		int count = 0;
+
+		for (int i = 0; i < shipCount; i++)
+		{
+			if (ships[i].alive && ships[i].owner == owner)
+				count++;
+		}
+
+		return count;
+	}
+	bool IsOver() const
+	{
+		return turn >= MAX_TURNS || GetShipCount(0) == 0 || GetShipCount(1) == 0;
+	}
+	/**
+	 * One turn of the referee, with the actions (and FIRE targets) already set on the ships.
+	 */
+	void Update()
+	{
+		for (int i = 0; i < cannonballCount; i++)
+		{
+			if (cannonballs[i].remainingTurns == 0)
+			{
+				cannonballs[i--] = cannonballs[--cannonballCount];
+				continue;
+			}
+
+			cannonballs[i].remainingTurns--;
+
+			if (cannonballs[i].remainingTurns == 0)
+				explosions[explosionCount++] = cannonballs[i].cell;
+		}
+
+		for (int i = 0; i < shipCount; i++)
+		{
+			if (!ships[i].alive)
+				continue;
+
+			ships[i].Damage(1);
+			ships[i].initialRum = ships[i].rum;
+		}
+
+		ApplyActions();
+		MoveShips();
+		RotateShips();
+		ExplodeCannonballs();
+
+		// sunk ships leave a barrel with part of their rum
+		for (int i = 0; i < shipCount; i++)
+		{
+			if (!ships[i].alive || ships[i].rum > 0)
+				continue;
+
+			int reward = min(REWARD_RUM_BARREL_VALUE, ships[i].initialRum);
+
+			if (reward > 0 && barrelCount < MAX_SIM_BARRELS)
+				barrels[barrelCount++] =
+				{ ships[i].cell, reward };
+
+			ships[i].alive = false;
+		}
+
+		turn++;
+	}
 };
 
-class StarboardAction: public Action
+//=============================================================
+// FUNCTIONS
+//=============================================================
+
+/**
+ * Game state as we see it: the mines out of sight are missing and the cannon cooldowns of the enemies are guessed from the
+ * cannonballs they fired. The cooldowns of the bot count down one turn ahead of the referee's.
+ */
+void BuildGameState(int turn, const vector<Ship>& myShips, const EntityTracker& tracker, const vector<OffsetCoord>& mines,
+		const vector<Barrel>& barrels, GameState& state)
+{
+	state = GameState();
+	state.turn = turn;
+
+	const vector<Ship>* fleets[2] =
+	{ &myShips, &tracker.GetEnemyShips() };
+
+	for (int owner = 0; owner < 2; owner++)
+	{
+		for (unsigned int i = 0; i < fleets[owner]->size() && state.shipCount < MAX_SIM_SHIPS; i++)
+		{
+			const Ship& ship = (*fleets[owner])[i];
+			SimShip& simShip = state.ships[state.shipCount++];
+
+			simShip.entityId = ship.GetEntityId();
+			simShip.owner = owner;
+			simShip.cell = OffsetToIndex(ship.GetCenterPosOffset());
+			simShip.rotation = ship.GetRotation();
+			simShip.speed = ship.GetSpeed();
+			simShip.rum = ship.GetRum();
+			simShip.initialRum = ship.GetRum();
+			simShip.cannonCooldown = (ship.GetHasFired() != 0) ? COOLDOWN_CANNON : 0;
+			simShip.mineCooldown = (ship.GetMineCooldown() > 0) ? ship.GetMineCooldown() + 1 : 0;
+			simShip.alive = true;
+			simShip.action = MOVE_WAIT;
+			simShip.target = -1;
+
+			if (owner == 0)
+				copy(OWN_MOVE_WEIGHTS, OWN_MOVE_WEIGHTS + MOVE_COUNT, simShip.moveWeights);
+			else
+				tracker.GetMoveWeights(simShip.entityId, simShip.moveWeights);
+		}
+	}
+
+	// the referee updates the ships in entity order
+	sort(state.ships, state.ships + state.shipCount, [](const SimShip& a, const SimShip& b)
+	{	return a.entityId < b.entityId;});
+
+	const vector<Cannonball>& cannonballs = tracker.GetCannonballs();
+
+	for (unsigned int i = 0; i < cannonballs.size() && state.cannonballCount < MAX_SIM_CANNONBALLS; i++)
+	{
+		if (IsInsideMap(cannonballs[i].target))
+			state.cannonballs[state.cannonballCount++] =
+			{ OffsetToIndex(cannonballs[i].target), cannonballs[i].remainingTurns };
+	}
+
+	for (unsigned int i = 0; i < mines.size() && state.mineCount < MAX_SIM_MINES; i++)
+		state.mines[state.mineCount++] = OffsetToIndex(mines[i]);
+
+	for (unsigned int i = 0; i < barrels.size() && state.barrelCount < MAX_SIM_BARRELS; i++)
+		state.barrels[state.barrelCount++] =
+		{ OffsetToIndex(barrels[i].offsetPos), barrels[i].amount };
+}
+
+}
+using namespace simulation;
+
+//#############################################################
+//#############################################################
+// NAMESPACE ENDGAME
+//#############################################################
+//#############################################################
+
+namespace endgame
+{
+
+//=============================================================
+// CONSTANTS
+//=============================================================
+
+const int RACE_MAX_BARRELS = 2; // the race starts with this few barrels left, the rollouts are too short to find them
+const float RACE_CHASE_PULL = 2; // value of a cell of distance to what the ship goes for
+const int RACE_CHASE_RANGE = 10; // cells, farther away than this from an enemy is as good
+
+//=============================================================
+// CLASSES
+//=============================================================
+
+/**
+ * The rum race once the barrels are gone: every ship loses one rum a turn, so without hits the end of the game is known.
+ * The side whose last ship sinks first loses, otherwise the rum left after the last turn decides. A barrel still on the map
+ * counts for the ship nearest to it.
+ */
+class RumRace
 {
+// VARIABLES
+private:
+	int _remainingTurns = 0;
+	int _scores[2] = { };
+	int _donors[2] = { -1, -1 }; // ship that should be sunk by a teammate, per side
+
+// FUNCTIONS
+private:
+	/**
+	 * Rum the side has left at the end of the game, or how many turns before the end its last ship sinks, as a negative.
+	 */
+	int Score(const GameState& state, const int* rums, int owner) const
+	{
+		int finalRum = 0;
+		int longest = 0;
+
+		for (int i = 0; i < state.shipCount; i++)
+		{
+			if (state.ships[i].owner != owner || rums[i] <= 0)
+				continue;
+
+			finalRum += max(0, rums[i] - _remainingTurns);
+			longest = max(longest, rums[i]);
+		}
+
+		return (longest > _remainingTurns) ? finalRum : longest - _remainingTurns;
+	}
+	/**
+	 * A ship that one cannonball sinks leaves its rum in a barrel that does not evaporate; a teammate picking it up can turn
+	 * two ships that sink before the end into one that lasts.
+	 */
+	void FindDonor(const GameState& state, int* rums, int owner)
+	{
+		int bestScore = _scores[owner];
+		_donors[owner] = -1;
+
+		for (int donor = 0; donor < state.shipCount; donor++)
+		{
+			if (state.ships[donor].owner != owner || rums[donor] <= 0 || rums[donor] > HIGH_DAMAGE)
+				continue;
+
+			for (int receiver = 0; receiver < state.shipCount; receiver++)
+			{
+				if (receiver == donor || state.ships[receiver].owner != owner || rums[receiver] <= 0)
+					continue;
+
+				int donorRum = rums[donor];
+				int receiverRum = rums[receiver];
+				rums[receiver] = min(MAX_SHIP_RUM, receiverRum + min(REWARD_RUM_BARREL_VALUE, donorRum));
+				rums[donor] = 0;
+
+				int score = Score(state, rums, owner);
+
+				rums[donor] = donorRum;
+				rums[receiver] = receiverRum;
+
+				if (score > bestScore)
+				{
+					bestScore = score;
+					_donors[owner] = donor;
+				}
+			}
+		}
+	}
+
 public:
-	StarboardAction(const Ship& initialState, shared_ptr<Action> previousAction, const CubeCoord& destination) :
-			Action(previousAction)
+	void Analyze(const GameState& state, bool findDonors)
 	{
-		_shipState = Ship(initialState);
+		_remainingTurns = max(0, MAX_TURNS - state.turn);
 
-		if (_firstCommand == "")
-			_firstCommand = "STARBOARD";
+		int rums[MAX_SIM_SHIPS];
 
-		ComputeMove();
+		for (int i = 0; i < state.shipCount; i++)
+			rums[i] = state.ships[i].alive ? state.ships[i].rum : 0;
 
-		_shipState.SetRotation(RoundDirection(_shipState.GetRotation() - 1));
-		ComputeHeuristic(destination);
+		for (int b = 0; b < state.barrelCount; b++)
+		{
+			int nearest = -1;
+
+			for (int i = 0; i < state.shipCount; i++)
+			{
+				if (rums[i] > 0 && (nearest < 0 || CellDistance(state.ships[i].cell, state.barrels[b].cell)
+								< CellDistance(state.ships[nearest].cell, state.barrels[b].cell)))
+					nearest = i;
+			}
+
+			if (nearest >= 0)
+				rums[nearest] = min(MAX_SHIP_RUM, rums[nearest] + state.barrels[b].rum);
+		}
+
+		for (int owner = 0; owner < 2; owner++)
+		{
+			_scores[owner] = Score(state, rums, owner);
+
+			if (findDonors)
+				FindDonor(state, rums, owner);
+			else
+				_donors[owner] = -1;
+		}
+	}
+	/**
+	 * How far we are ahead in the race, in rum.
+	 */
+	int GetMargin() const
+	{
+		return _scores[0] - _scores[1];
 	}
-	string GetCommand()
+	int GetDonor(int owner) const
 	{
-		return "STARBOARD";
+		return _donors[owner];
 	}
 };
 
-class FasterAction: public Action
+//=============================================================
+// FUNCTIONS
+//=============================================================
+
+/**
+ * Value of the position of one of our ships in the race: close to the last barrels while there are some, then close to the
+ * enemy when we have to hit it to win, away from it when we only have to last.
+ */
+float EvaluateChase(const GameState& state, int shipIndex, bool ahead)
+{
+	const SimShip& ship = state.ships[shipIndex];
+
+	if (state.barrelCount > 0)
+	{
+		int distance = MAP_WIDTH + MAP_HEIGHT;
+
+		for (int b = 0; b < state.barrelCount; b++)
+			distance = min(distance, CellDistance(ship.cell, state.barrels[b].cell));
+
+		return -RACE_CHASE_PULL * distance;
+	}
+
+	int distance = RACE_CHASE_RANGE;
+
+	for (int i = 0; i < state.shipCount; i++)
+	{
+		if (state.ships[i].alive && state.ships[i].owner != ship.owner)
+			distance = min(distance, CellDistance(ship.cell, state.ships[i].cell));
+	}
+
+	return RACE_CHASE_PULL * (ahead ? distance : -distance);
+}
+
+}
+using namespace endgame;
+
+//#############################################################
+//#############################################################
+// NAMESPACE FLEET
+//#############################################################
+//#############################################################
+
+namespace fleet
+{
+
+//=============================================================
+// CONSTANTS
+//=============================================================
+
+// every ship is commanded by the fleet search instead of the command chain (wins 69 of 70 local games against the chain alone);
+// a build with COTC_COMMAND_CHAIN keeps the chain alone, to play it against the fleet search in the referee
+#ifndef COTC_COMMAND_CHAIN
+const bool USE_FLEET_SEARCH = true;
+#else
+const bool USE_FLEET_SEARCH = false;
+#endif
+const double FLEET_TIME_RESERVE = 3; // ms of the turn left after the search, for the command chain when it did no iteration
+
+const int FLEET_POOL_SIZE = 1 << 14; // nodes, about 5.5 MB
+const int MAX_FLEET_DEPTH = 4; // turns in the tree
+const int FLEET_ROLLOUT_DEPTH = 4; // turns played out after the tree
+const float FLEET_EXPLORATION = 0.5f;
+const float FLEET_RUM_SCALE = 40; // rum difference at which the reward is about 0.73
+const float FLEET_BARREL_PULL = 10; // value of being next to a full barrel
+
+//=============================================================
+// STRUCTS
+//=============================================================
+
+/**
+ * Node of the fleet search. A child is reached by a joint action of all the ships; each ship keeps its own statistics of
+ * its actions (decoupled UCT), since the players choose at the same time.
+ */
+struct FleetNode
+{
+	int firstChild = -1;
+	int nextSibling = -1;
+	int jointAction = -1;
+	int visits = 0;
+	int actionVisits[MAX_SIM_SHIPS][SIM_ACTION_COUNT] = { };
+	float actionValues[MAX_SIM_SHIPS][SIM_ACTION_COUNT] = { };
+};
+
+//=============================================================
+// CLASSES
+//=============================================================
+
+/**
+ * Monte Carlo tree search over the actions of all the ships, ours and the enemy's, with the simulator as the model. The
+ * nodes come from a pool allocated once and reused every turn.
+ */
+class FleetSearch
 {
+// VARIABLES
+private:
+	vector<FleetNode> _pool;
+	int _nodeCount = 0;
+	GameState _root;
+	int _iterations = 0;
+	bool _endgame = false; // hardly any barrels left at the root, the leaves are scored by the rum race
+	RumRace _race; // of the root
+	unsigned int _random = 1; // xorshift, seeded every turn so that the search does not touch the global rand() state
+
+// CONSTRUCTORS
+public:
+	FleetSearch() :
+			_pool(FLEET_POOL_SIZE)
+	{
+	}
+
+// FUNCTIONS
+private:
+	int NewNode(int jointAction)
+	{
+		if (_nodeCount >= FLEET_POOL_SIZE)
+			return -1;
+
+		_pool[_nodeCount] = FleetNode();
+		_pool[_nodeCount].jointAction = jointAction;
+		return _nodeCount++;
+	}
+	int FindChild(int node, int jointAction) const
+	{
+		for (int child = _pool[node].firstChild; child >= 0; child = _pool[child].nextSibling)
+		{
+			if (_pool[child].jointAction == jointAction)
+				return child;
+		}
+
+		return -1;
+	}
+	/**
+	 * Cell the ship fires at: a teammate worth sinking in the rum race, otherwise the nearest enemy.
+	 */
+	int GetFireTarget(const GameState& state, int shipIndex) const
+	{
+		int donor = _endgame ? _race.GetDonor(state.ships[shipIndex].owner) : -1;
+
+		if (donor >= 0 && donor != shipIndex && state.ships[donor].alive)
+		{
+			int target = state.GetFireTarget(shipIndex, donor);
+
+			if (target >= 0)
+				return target;
+		}
+
+		return state.GetFireTarget(shipIndex);
+	}
+	/**
+	 * Actions that do something different from WAIT for the ship. The FIRE target is set on the ship.
+	 */
+	void GetUsefulActions(GameState& state, int shipIndex, bool* useful) const
+	{
+		SimShip& ship = state.ships[shipIndex];
+
+		for (int action = 0; action < SIM_ACTION_COUNT; action++)
+			useful[action] = true;
+
+		useful[MOVE_FASTER] = ship.speed < MAX_SHIP_SPEED;
+		useful[MOVE_SLOWER] = ship.speed > 0;
+		useful[SIM_MINE] = ship.mineCooldown <= 1;
+
+		ship.target = (ship.cannonCooldown <= 1) ? GetFireTarget(state, shipIndex) : -1;
+		useful[SIM_FIRE] = ship.target >= 0;
+	}
+	int SelectAction(const FleetNode& node, int shipIndex, const bool* useful) const
+	{
+		float logVisits = log((float) node.visits + 1);
+		int bestAction = MOVE_WAIT;
+		float bestScore = -1;
+
+		for (int action = 0; action < SIM_ACTION_COUNT; action++)
+		{
+			if (!useful[action])
+				continue;
+
+			int visits = node.actionVisits[shipIndex][action];
+
+			if (visits == 0)
+				return action;
+
+			float score = node.actionValues[shipIndex][action] / visits + FLEET_EXPLORATION * sqrt(logVisits / visits);
+
+			if (score > bestScore)
+			{
+				bestScore = score;
+				bestAction = action;
+			}
+		}
+
+		return bestAction;
+	}
+	unsigned int NextRandom()
+	{
+		_random ^= _random << 13;
+		_random ^= _random >> 17;
+		_random ^= _random << 5;
+		return _random;
+	}
+	/**
+	 * The ships move at random with their move weights: ours mostly keep their course, the enemies follow their model.
+	 */
+	void Rollout(GameState& state)
+	{
+		for (int turn = 0; turn < FLEET_ROLLOUT_DEPTH && !state.IsOver(); turn++)
+		{
+			for (int i = 0; i < state.shipCount; i++)
+			{
+				float roll = (NextRandom() & 0xFFFF) / 65536.f;
+				int move = 0;
+
+				while (move < MOVE_COUNT - 1 && roll >= state.ships[i].moveWeights[move])
+					roll -= state.ships[i].moveWeights[move++];
+
+				state.ships[i].action = move;
+			}
+
+			state.Update();
+		}
+	}
+	/**
+	 * Reward of the state for us, in [0, 1]: the rum difference, with some credit for the barrels within reach. In the
+	 * endgame the difference is the one at the end of the rum race.
+	 */
+	float Evaluate(const GameState& state) const
+	{
+		float score = 0;
+		RumRace race;
+
+		if (_endgame)
+		{
+			race.Analyze(state, false);
+			score = race.GetMargin();
+		}
+
+		for (int i = 0; i < state.shipCount; i++)
+		{
+			const SimShip& ship = state.ships[i];
+
+			if (!ship.alive)
+				continue;
+
+			float value = _endgame ? 0 : ship.rum;
+
+			if (_endgame && ship.owner == 0)
+				value += EvaluateChase(state, i, race.GetMargin() > 0);
+
+			for (int b = 0; b < state.barrelCount; b++)
+			{
+				float pull = FLEET_BARREL_PULL * state.barrels[b].rum / MAX_SHIP_RUM / (1 + CellDistance(ship.cell, state.barrels[b].cell));
+				value += min((float) MAX_SHIP_RUM - ship.rum, pull);
+			}
+
+			score += (ship.owner == 0) ? value : -value;
+		}
+
+		return 1 / (1 + exp(-score / FLEET_RUM_SCALE));
+	}
+	void Iterate()
+	{
+		GameState state = _root;
+		int path[MAX_FLEET_DEPTH + 1];
+		int actions[MAX_FLEET_DEPTH][MAX_SIM_SHIPS];
+		int depth = 0;
+
+		path[0] = 0;
+
+		while (depth < MAX_FLEET_DEPTH && !state.IsOver())
+		{
+			const FleetNode& node = _pool[path[depth]];
+			int jointAction = 0;
+
+			for (int i = 0; i < state.shipCount; i++)
+			{
+				int action = MOVE_WAIT;
+
+				if (state.ships[i].alive)
+				{
+					bool useful[SIM_ACTION_COUNT];
+					GetUsefulActions(state, i, useful);
+					action = SelectAction(node, i, useful);
+				}
+
+				actions[depth][i] = action;
+				state.ships[i].action = action;
+				jointAction = jointAction * SIM_ACTION_COUNT + action;
+			}
+
+			state.Update();
+
+			int child = FindChild(path[depth], jointAction);
+			bool expanded = child < 0;
+
+			if (expanded)
+			{
+				child = NewNode(jointAction);
+
+				if (child < 0)
+				{
+					depth++;
+					break;
+				}
+
+				_pool[child].nextSibling = _pool[path[depth]].firstChild;
+				_pool[path[depth]].firstChild = child;
+			}
+
+			path[++depth] = child;
+
+			if (expanded)
+				break;
+		}
+
+		Rollout(state);
+		float reward = Evaluate(state);
+
+		for (int d = 0; d < depth; d++)
+		{
+			FleetNode& node = _pool[path[d]];
+			node.visits++;
+
+			for (int i = 0; i < _root.shipCount; i++)
+			{
+				node.actionVisits[i][actions[d][i]]++;
+				node.actionValues[i][actions[d][i]] += (_root.ships[i].owner == 0) ? reward : 1 - reward;
+			}
+		}
+	}
 public:
-	FasterAction(const Ship& initialState, shared_ptr<Action> previousAction, const CubeCoord& destination) :
-			Action(previousAction)
+	/**
+	 * Searches until the deadline from a snapshot of the turn, which is only read.
+	 */
+	void Search(const GameState& root, unsigned int seed, double deadline)
 	{
-		_shipState = Ship(initialState);
+		_root = root;
+		_random = seed | 1;
+		_endgame = _root.barrelCount <= RACE_MAX_BARRELS;
 
-		if (_firstCommand == "")
-			_firstCommand = "FASTER";
+		if (_endgame)
+			_race.Analyze(_root, true);
 
-		if (_shipState.GetSpeed() < 2)
-			_shipState.SetSpeed(_shipState.GetSpeed() + 1);
+		_nodeCount = 0;
+		_iterations = 0;
+		NewNode(-1);
 
-		ComputeMove();
-		ComputeHeuristic(destination);
+		while (!IsPast(deadline))
+		{
+			for (int i = 0; i < 16; i++)
+				Iterate();
+
+			_iterations += 16;
+		}
 	}
-	string GetCommand()
+	int GetIterations() const
 	{
-		return "FASTER";
+		return _iterations;
 	}
-};
-
-class SlowerAction: public Action
-{
-public:
-	SlowerAction(const Ship& initialState, shared_ptr<Action> previousAction, const CubeCoord& destination) :
-			Action(previousAction)
+	int GetNodeCount() const
 	{
-		_shipState = Ship(initialState);
-
-		if (_firstCommand == "")
-			_firstCommand = "SLOWER";
-
-		if (_shipState.GetSpeed() > 0)
-			_shipState.SetSpeed(_shipState.GetSpeed() - 1);
-
-		ComputeMove();
-		ComputeHeuristic(destination);
+		return _nodeCount;
+	}
+	const RumRace* GetRace() const
+	{
+		return _endgame ? &_race : nullptr;
 	}
-	string GetCommand()
+	int GetRootVisits(int shipIndex, int action) const
 	{
-		return "SLOWER";
+		return _pool[0].actionVisits[shipIndex][action];
+	}
+	/**
+	 * Action of one of the ships at the root, as a command.
+	 */
+	Command ToCommand(int shipIndex, int action) const
+	{
+		if (action == SIM_FIRE)
+		{
+			int target = GetFireTarget(_root, shipIndex);
+			return FireCommand(OffsetCoord(target % MAP_WIDTH, target / MAP_WIDTH));
+		}
+		else if (action == SIM_MINE)
+			return MineCommand();
+		else
+			return MoveCommand(action);
 	}
 };
 
-template<typename T, typename priority_t>
-class PriorityQueue
+/**
+ * Runs the fleet search on a frozen snapshot of the turn and turns the visits at the root into one command per ship of ours.
+ * The ships choose their actions separately, so two of them can get in each other's way; the one less sure of its action
+ * then takes its next best one.
+ */
+class FleetCommander
 {
-	typedef pair<priority_t, T> element;
+// VARIABLES
+private:
+	FleetSearch _search;
+	GameState _snapshot;
+	int _actions[MAX_SIM_SHIPS]; // choice per ship, -1 for the enemy's
+	GameState _alone[MAX_SIM_SHIPS]; // the snapshot one turn later when only that ship of ours plays its choice
 
-	struct PriorityCompare
+// FUNCTIONS
+private:
+	/**
+	 * Plays the choices of the ships of ours in the mask for one turn on the snapshot, with every other ship left out.
+	 */
+	void PlayTurn(int shipMask, GameState& state) const
 	{
-		bool operator()(const element& lhs, const element& rhs)
+		state = _snapshot;
+
+		for (int i = 0; i < state.shipCount; i++)
 		{
-			return lhs.first > rhs.first;
+			SimShip& ship = state.ships[i];
+			ship.alive = ship.alive && ((shipMask >> i) & 1);
+			ship.action = (ship.alive && _actions[i] >= 0) ? _actions[i] : MOVE_WAIT;
+			ship.target = (ship.action == SIM_FIRE) ? _search.ToCommand(i, SIM_FIRE).argument : -1;
 		}
-	};
 
-public:
-	inline bool Empty() const
-	{
-		return elements.empty();
+		state.Update();
 	}
-
-	inline void Push(T item, priority_t priority)
+	void SetAction(int shipIndex, int action)
 	{
-		elements.emplace(priority, item);
+		_actions[shipIndex] = action;
+		PlayTurn(1 << shipIndex, _alone[shipIndex]);
 	}
-
-	inline T Pop()
+	/**
+	 * Whether one cannonball fired by the ship on the cell sinks a ship predicted to be there.
+	 */
+	bool IsSunkByOneHit(int shipIndex, int target) const
 	{
-		T item = elements.top().second;
-		elements.pop();
-		return item;
-		/*element e = elements.top();
-		 priority_t p = e.first;
-		 item = e.second;
-		 elements.pop();
-		 return p;*/
-	}
-
-private:
-	priority_queue<element, vector<element>, PriorityCompare> elements;
-};
+		for (int i = 0; i < _snapshot.shipCount; i++)
+		{
+			const SimShip& victim = _snapshot.ships[i];
 
-void ExpandAction(const Ship& initialState, shared_ptr<Action> previousAction, const vector<string>* obstacleMap,
-		const OffsetCoord& destination, vector<shared_ptr<Action>>& actions, PriorityQueue<shared_ptr<Action>, int>& queue)
-{
-	vector<shared_ptr<Action>> newActions;
-	CubeCoord cubeDestination = OffsetToCube(destination);
+			if (i != shipIndex && victim.alive && victim.rum <= HIGH_DAMAGE && _snapshot.GetFireTarget(shipIndex, i) == target)
+				return true;
+		}
 
-	if (initialState.GetSpeed() > 0)
-	{
-		shared_ptr<Action> waitAction(new WaitAction(initialState, previousAction, cubeDestination));
-		newActions.push_back(waitAction);
+		return false;
 	}
+	/**
+	 * Which of two ships of ours has to change its action, -1 if their choices go together: they must not both fire at a
+	 * ship that one cannonball sinks, or run into each other.
+	 */
+	int GetConflictLoser(int i, int j) const
+	{
+		int lessSure = (_search.GetRootVisits(i, _actions[i]) < _search.GetRootVisits(j, _actions[j])) ? i : j;
 
-	shared_ptr<Action> portAction(new PortAction(initialState, previousAction, cubeDestination));
-	newActions.push_back(portAction);
-
-	shared_ptr<Action> starboardAction(new StarboardAction(initialState, previousAction, cubeDestination));
-	newActions.push_back(starboardAction);
+		if (_actions[i] == SIM_FIRE && _actions[j] == SIM_FIRE)
+		{
+			int target = _search.ToCommand(i, SIM_FIRE).argument;
 
-	if (initialState.GetSpeed() < 2)
-	{
-		shared_ptr<Action> fasterAction(new FasterAction(initialState, previousAction, cubeDestination));
-		newActions.push_back(fasterAction);
-	}
+			if (target == _search.ToCommand(j, SIM_FIRE).argument && IsSunkByOneHit(i, target))
+				return lessSure;
+		}
 
-	if (initialState.GetSpeed() > 0)
-	{
-		shared_ptr<Action> slowerAction(new SlowerAction(initialState, previousAction, cubeDestination));
-		newActions.push_back(slowerAction);
-	}
+		// a ship that ends elsewhere than when it plays alone ran into the other one
+		GameState together;
+		PlayTurn((1 << i) | (1 << j), together);
 
-	for (unsigned int i = 0; i < newActions.size(); i++)
-	{
-		//cerr << "pre legal test, i=" << i << endl;
-		if (newActions[i]->IsLegal(obstacleMap))
+		for (int k : { i, j })
 		{
-			//cerr << "ExpandAction: new action is legal" << endl;
-			int index = actions.size();
-			actions.push_back(newActions[i]);
-			shared_ptr<Action> action = actions.at(index);
-			queue.Push(action, newActions[i]->GetTotalCost());
+			if (together.ships[k].cell != _alone[k].ships[k].cell || together.ships[k].rotation != _alone[k].ships[k].rotation)
+				return lessSure;
 		}
-		//else
-		//cerr << "ExpandAction: new action is illegal" << endl;
+
+		return -1;
 	}
-}
+	/**
+	 * The loser of a conflict takes the most visited of its other actions that settles it, or keeps its own if none does.
+	 */
+	void ResolveConflicts()
+	{
+		for (int i = 0; i < _snapshot.shipCount; i++)
+		{
+			for (int j = i + 1; j < _snapshot.shipCount; j++)
+			{
+				if (_actions[i] < 0 || _actions[j] < 0)
+					continue;
 
-int FindPath(const Ship& ship, const vector<string>* objectMap, const OffsetCoord destination, string& command)
-{
-	timespec begin;
-	clock_gettime(CLOCK_REALTIME, &begin);
+				int loser = GetConflictLoser(i, j);
 
-	vector<shared_ptr<Action>> actions;
-	PriorityQueue<shared_ptr<Action>, int> queue;
+				if (loser < 0)
+					continue;
 
-	ExpandAction(ship, nullptr, objectMap, destination, actions, queue);
+				int chosen = _actions[loser];
+				bool tried[SIM_ACTION_COUNT] = { };
+				tried[chosen] = true;
 
-	shared_ptr<Action> lastAction = nullptr;
+				while (true)
+				{
+					int next = GetBestAction(loser, tried);
 
-	while (!queue.Empty())
-	{
-		shared_ptr<Action> currentAction = queue.Pop();
+					if (next < 0)
+					{
+						SetAction(loser, chosen);
+						break;
+					}
 
-		if (elapsed(begin) > 5)
-		 {
-		 lastAction = currentAction;
-		 break;
-		 }
+					tried[next] = true;
+					SetAction(loser, next);
 
-		Ship currentShipState = Ship(currentAction->GetShipState());
+					if (GetConflictLoser(i, j) < 0)
+						break;
+				}
+			}
+		}
+	}
+	/**
+	 * Most visited action of the ship at the root, leaving out the excluded ones; -1 if none was visited.
+	 */
+	int GetBestAction(int shipIndex, const bool* excluded) const
+	{
+		int bestAction = -1;
 
-		if (currentShipState.GetFrontPos() == destination)
+		for (int action = 0; action < SIM_ACTION_COUNT; action++)
 		{
-			lastAction = currentAction;
-			break;
+			int visits = _search.GetRootVisits(shipIndex, action);
+
+			if (!excluded[action] && visits > 0 && (bestAction < 0 || visits > _search.GetRootVisits(shipIndex, bestAction)))
+				bestAction = action;
 		}
 
-		ExpandAction(currentShipState, currentAction, objectMap, destination, actions, queue);
+		return bestAction;
 	}
 
-	int result = -1;
-	if (lastAction != nullptr)
+public:
+	void Search(int turn, const vector<Ship>& myShips, const EntityTracker& tracker, const vector<OffsetCoord>& mines,
+			const vector<Barrel>& barrels, double deadline)
 	{
-		command = (*lastAction).GetFirstCommand();
-		result = 1;
-		cerr << "FindPath successfull!" << endl;
+		BuildGameState(turn, myShips, tracker, mines, barrels, _snapshot);
+		_search.Search(_snapshot, rand(), deadline);
+
+		bool excluded[SIM_ACTION_COUNT] = { };
+
+		for (int i = 0; i < _snapshot.shipCount; i++)
+			_actions[i] = -1;
+
+		for (int i = 0; i < _snapshot.shipCount; i++)
+		{
+			if (_snapshot.ships[i].owner == 0)
+				SetAction(i, GetBestAction(i, excluded));
+		}
+
+		ResolveConflicts();
+
+		cerr << "FleetSearch: iterations=" << _search.GetIterations() << " nodes=" << _search.GetNodeCount() << endl;
+
+		const RumRace* race = _search.GetRace();
+
+		if (race != nullptr)
+			cerr << "FleetSearch: rum race margin=" << race->GetMargin() << " donor=" << race->GetDonor(0) << endl;
 	}
-	else
-		cerr << "FindPath failed!" << endl;
+	/**
+	 * Choice of one of our ships, as a command.
+	 */
+	bool GetCommand(int entityId, Command& command) const
+	{
+		for (int i = 0; i < _snapshot.shipCount; i++)
+		{
+			if (_snapshot.ships[i].entityId != entityId || _snapshot.ships[i].owner != 0)
+				continue;
 
-	return result;
-}
+			if (_actions[i] < 0)
+				return false;
+
+			command = _search.ToCommand(i, _actions[i]);
+			return true;
+		}
+
+		return false;
+	}
+};
 
 }
-using namespace pathfinder;
+using namespace fleet;
 
 //=============================================================
 // DECLARATIONS
 //=============================================================
 
-bool CommandGoToBarrel(Ship* ship, const vector<Barrel>& barrels, const vector<string>* objectMap);
-bool CommandWander(Ship* ship, const vector<string>* objectMap);
-bool CommandFire(Ship* ship, const vector<Ship>& enemyShips);
-bool CommandEmergencyEvading(Ship* ship, const vector<string>* objectMap);
-bool CommandFollow(Ship* ship, const vector<Ship>& enemyShips, const vector<string>* objectMap);
+bool CommandFleetSearch(Ship* ship, const FleetCommander& fleetSearch, Command& command);
+bool CommandGoToBarrel(Ship* ship, const BarrelRouter& barrelRouter, Command& command);
+bool CommandWander(Ship* ship, const vector<string>* objectMap, DistanceFieldCache* distanceFields, const DangerMap* dangerMap,
+		PathPlanner* pathPlanner, double deadline, Command& command);
+bool CommandFire(Ship* ship, const EnemyForecast& forecast, const vector<OffsetCoord>& mines, const vector<Ship>& myShips,
+		Command& command);
+bool CommandMine(Ship* ship, const EnemyForecast& forecast, const vector<Ship>& myShips, const vector<Ship>& enemyShips,
+		const vector<Barrel>& barrels, const vector<string>* objectMap, Command& command);
+bool CommandEmergencyEvading(Ship* ship, const vector<string>* objectMap, const DangerMap* dangerMap, Command& command);
+bool CommandFollow(Ship* ship, const vector<Ship>& enemyShips, DistanceFieldCache* distanceFields, const DangerMap* dangerMap,
+		PathPlanner* pathPlanner, double deadline, Command& command);
+void ReadTurn(istream& input, int entityCount, vector<Ship>& myShips, EntityTracker& tracker, vector<Barrel>& barrels,
+		vector<OffsetCoord>& mines, vector<string>& objectMap);
 
 //=============================================================
 // MAIN
 //=============================================================
-int main()
+// the benchmark includes this file and brings its own main
+#ifndef COTC_BENCHMARK
+int main(int argc, char** argv)
 {
-	srand(time(NULL));
+	// the local referee passes a seed so that matches can be replayed
+	srand((argc > 1) ? strtoul(argv[1], nullptr, 10) : time(NULL));
 
 // game loop variables
 	vector<Ship> _myShips;
-	vector<Ship> _enemyShips;
 	vector<Barrel> _barrels;
+	vector<OffsetCoord> _mines;
+
+	EntityTracker _tracker;
+
+	TurnBudget _budget;
+	int _turn = 0; // of the game, the referee counts the same
+
+	DistanceFieldCache _distanceFields;
+	BarrelRouter _barrelRouter;
+	EnemyForecast _enemyForecast;
+	DangerMap _dangerMap;
+	PathPlanner _pathPlanner;
+	FleetCommander _fleetSearch;
+	CommandOutput _output;
 
 // Map with all the obstacles
 // "e" = no obstacle
 // "M" = Mine
-// "C" = Canonball
+// "S<id>" = Ship
 	vector<string> _objectMap = vector<string>(MAP_WIDTH * MAP_HEIGHT, "e");
 
 	/*for (int col = 0; col < MAP_WIDTH; col++)
@@ -804,207 +4515,149 @@ int main()
 // game loop
 	while (1)
 	{
-		timespec beginMain;
-		clock_gettime(CLOCK_REALTIME, &beginMain);
-
 		int myShipCount; // the number of remaining ships
 		cin >> myShipCount;
 		cin.ignore();
 
+		// the clock only starts once the referee has sent the turn
+		_budget.StartTurn((_turn == 0) ? FIRST_TURN_TIME : TURN_TIME, myShipCount);
+
+		// everything allocated during the last turn is dropped at once
+		TURN_ARENA.Reset();
+
 		int entityCount; // the number of entities (e.g. ships, mines or cannonballs)
 		cin >> entityCount;
 		cin.ignore();
 
-		for (int i = 0; i < entityCount; i++)
-		{
-			int entityId;
-			string entityType;
-			int x;
-			int y;
-			int arg1;
-			int arg2;
-			int arg3;
-			int arg4;
-			cin >> entityId >> entityType >> x >> y >> arg1 >> arg2 >> arg3 >> arg4;
-			cin.ignore();
-
-			if (entityType == "SHIP")
-			{
-				Ship* ship;
+		ReadTurn(cin, entityCount, _myShips, _tracker, _barrels, _mines, _objectMap);
+		const vector<Ship>& _enemyShips = _tracker.GetEnemyShips();
 
-				if (arg4 == 1)
-				{
-					ship = GetShip(_myShips, entityId);
+		_distanceFields.Reset(&_objectMap);
+		_dangerMap.Build(_tracker, _mines, _myShips);
+		_pathPlanner.BeginTurn();
 
-					if (ship == nullptr)
-					{
-						_myShips.emplace_back(entityId, x, y, arg1, arg2, arg3);
-						ship = &_myShips[_myShips.size() - 1];
-					}
-					else
-					{
-						//cerr << "rum1=" << arg3 << endl;
-						ship->Update(x, y, arg1, arg2, arg3);
-					}
-				}
-				else
-				{
-					_enemyShips.emplace_back(entityId, x, y, arg1, arg2, arg3);
-					ship = &_myShips[_enemyShips.size() - 1];
-				}
+		if (USE_FLEET_SEARCH)
+			_fleetSearch.Search(_turn, _myShips, _tracker, _mines, _barrels, _budget.GetDeadline() - FLEET_TIME_RESERVE);
 
-				_objectMap[OffsetToIndex(ship->GetCenterPosOffset())] = string("S") + to_string(ship->GetEntityId());
-				_objectMap[OffsetToIndex(ship->GetFrontPos())] = string("S") + to_string(ship->GetEntityId());
-				_objectMap[OffsetToIndex(ship->GetBackPos())] = string("S") + to_string(ship->GetEntityId());
-			}
-			else if (entityType == "BARREL")
-			{
-				_barrels.emplace_back(Barrel(x, y, arg1));
-				//_objectMap[PosToIndex(x, y)] = 'B';
-			}
-			else if (entityType == "CANNONBALL")
-			{
-				_objectMap[PosToIndex(x, y)] = string("C") + to_string(arg2);
-			}
-			else if (entityType == "MINE")
-			{
-				_objectMap[PosToIndex(x, y)] = string("M");
-				//cerr << "objectMap at(" << x << "," << y << ")=" << _objectMap.at(PosToIndex(x, y)) << endl;
-			}
-		}
+		// the barrel routes and the enemy forecast only serve the command chain, they wait for a ship the fleet search has no
+		// action for, which only happens when it could not do a single iteration
+		bool commandChainReady = !USE_FLEET_SEARCH;
 
-		for (unsigned int i = 0; i < _myShips.size(); i++)
+		if (commandChainReady)
 		{
-			//Ship* ship = &_myShips.at(i);
-			//int index = OffsetToIndex(ship->GetCenterPosOffset());
-			//cerr << "shipId="<< ship->GetEntityId()<< " index="<<index<< " content=" << _objectMap.at(index) << endl;
-
-			if (!_myShips[i].GetUpdated())
-			{
-				_myShips.erase(_myShips.begin() + i);
-				i--;
-			}
+			_barrelRouter.Plan(_myShips, _barrels, _distanceFields, _dangerMap);
+			_enemyForecast.Predict(_tracker, _distanceFields);
 		}
 
-		//cerr << "elapsed=" << elapsed(beginMain) << endl;
-
-		double maxShipTime = 15;
-		if (myShipCount == 1)
-			maxShipTime = 45;
-		else if (myShipCount == 2)
-			maxShipTime = 22.5;
+		//cerr << "elapsed=" << _budget.Elapsed() << endl;
 
 		for (int i = 0; i < myShipCount; i++)
 		{
-			if (elapsed(beginMain) > 45)
+			double shipDeadline = _budget.NextSlice();
+
+			Ship* currentShip = &_myShips[i];
+			Command command;
+
+			if (USE_FLEET_SEARCH && CommandFleetSearch(currentShip, _fleetSearch, command))
 			{
-				cerr << "Out of time 1!" << endl;
-				cout << "WAIT" << endl;
+				cerr << "Command: Fleet Search!" << endl;
+				_output.Add(command);
 				continue;
 			}
 
-			timespec begin;
-			clock_gettime(CLOCK_REALTIME, &begin);
-
-			Ship* currentShip = &_myShips[i];
+			if (!commandChainReady)
+			{
+				_barrelRouter.Plan(_myShips, _barrels, _distanceFields, _dangerMap);
+				_enemyForecast.Predict(_tracker, _distanceFields);
+				commandChainReady = true;
+			}
 
-			if (CommandEmergencyEvading(currentShip, &_objectMap))
+			if (CommandEmergencyEvading(currentShip, &_objectMap, &_dangerMap, command))
 			{
 				cerr << "Command: Emergency Evading!" << endl;
-				continue;
 			}
-			else if (CommandFire(currentShip, _enemyShips))
+			else if (CommandFire(currentShip, _enemyForecast, _mines, _myShips, command))
 			{
 				cerr << "Command: Fire!" << endl;
-				continue;
 			}
-			else if (currentShip->GetRum() <= 70 && CommandGoToBarrel(currentShip, _barrels, &_objectMap))
+			else if (CommandMine(currentShip, _enemyForecast, _myShips, _enemyShips, _barrels, &_objectMap, command))
 			{
-				cerr << "Command: Go To Barrel!" << endl;
-				continue;
+				cerr << "Command: Mine!" << endl;
 			}
-			else if (elapsed(begin) > maxShipTime || elapsed(beginMain) > 45)
+			else if (currentShip->GetRum() <= BARREL_RUM_THRESHOLD && CommandGoToBarrel(currentShip, _barrelRouter, command))
 			{
-				cerr << "Out of time 2!" << endl;
-				cout << "WAIT" << endl;
-				continue;
+				cerr << "Command: Go To Barrel!" << endl;
 			}
-			else if (CommandFollow(currentShip, _enemyShips, &_objectMap))
+			else if (CommandFollow(currentShip, _enemyShips, &_distanceFields, &_dangerMap, &_pathPlanner, shipDeadline, command))
 			{
 				cerr << "Command: Follow!" << endl;
-				continue;
 			}
-			else if (elapsed(begin) > maxShipTime || elapsed(beginMain) > 45)
+			else if (CommandWander(currentShip, &_objectMap, &_distanceFields, &_dangerMap, &_pathPlanner, shipDeadline, command))
 			{
-				cerr << "Out of time 3!" << endl;
-				cout << "WAIT" << endl;
-				continue;
+				cerr << "Command: Wander!" << endl;
 			}
-			else if (CommandWander(currentShip, &_objectMap))
+			else
 			{
-				cerr << "Command: Wander!" << endl;
-				continue;
+				cerr << "reached end!" << endl;
+				command = MoveCommand(MOVE_WAIT);
 			}
 
-			cerr << "reached end!" << endl;
-			cout << "WAIT" << endl;
+			_output.Add(command);
 		}
 
+		// one write for the whole turn
+		_output.Flush(cout);
+		_turn++;
+
 		// cleaning up
 		for (unsigned int i = 0; i < _myShips.size(); i++)
 		{
 			_myShips[i].SetUpdated(false);
 		}
 
-		_enemyShips.clear();
 		_barrels.clear();
+		_mines.clear();
 
-		_objectMap = vector<string>(MAP_WIDTH * MAP_HEIGHT, "e");
-//		for (unsigned int index = 0; index < _objectMap.size(); index++)
-//		{
-//			_objectMap.at(index) = "e";
-//		}
+		// the cells are overwritten in place, the short strings do not allocate
+		fill(_objectMap.begin(), _objectMap.end(), "e");
 
-		cerr << "elapsed=" << elapsed(beginMain) << endl;
+		cerr << "elapsed=" << _budget.Elapsed() << endl;
 	}
 }
+#endif
 
 //=============================================================
 //
 //=============================================================
 
-bool CommandGoToBarrel(Ship* ship, const vector<Barrel>& barrels, const vector<string>* objectMap)
+bool CommandFleetSearch(Ship* ship, const FleetCommander& fleetSearch, Command& command)
 {
-	int shortestDistance = 999;
-	OffsetCoord nearestBarrelPos;
-	for (unsigned int barrelIndex = 0; barrelIndex < barrels.size(); barrelIndex++)
-	{
-		Barrel currentBarrel = barrels[barrelIndex];
+	if (!fleetSearch.GetCommand(ship->GetEntityId(), command))
+		return false;
 
-		int distance = ComputeDistance(ship->GetCenterPosCube(), currentBarrel.cubePos);
+	// the cooldowns are kept as the other commands keep them
+	if (command.type == COMMAND_FIRE)
+		ship->SetHasFired(1);
+	else if (command.type == COMMAND_MINE)
+		ship->SetMineCooldown(COOLDOWN_MINE);
 
-		if (distance < shortestDistance)
-		{
-			shortestDistance = distance;
-			nearestBarrelPos = currentBarrel.offsetPos;
-		}
-	}
+	return true;
+}
 
-	if (!nearestBarrelPos.IsNull())
-	{
-		string command;
-		if (FindPath(*ship, objectMap, nearestBarrelPos, command) > 0)
-		{
-			//cerr << "FindPath success, command=" << command << endl;
-			cout << command << endl;
-			return true;
-		}
-	}
+bool CommandGoToBarrel(Ship* ship, const BarrelRouter& barrelRouter, Command& command)
+{
+	const BarrelRoute* route = barrelRouter.GetRoute(ship->GetEntityId());
 
-	return false;
+	if (route == nullptr || route->firstMove < 0)
+		return false;
+
+	//cerr << "CommandGoToBarrel: tour length=" << route->barrels.size() << " score=" << route->score << endl;
+	command = MoveCommand(route->firstMove);
+	return true;
 }
 
-bool CommandWander(Ship* ship, const vector<string>* objectMap)
+bool CommandWander(Ship* ship, const vector<string>* objectMap, DistanceFieldCache* distanceFields, const DangerMap* dangerMap,
+		PathPlanner* pathPlanner, double deadline, Command& command)
 {
 	if (ship->GetCenterPosOffset() == ship->GetWanderTarget())
 	{
@@ -1026,45 +4679,30 @@ bool CommandWander(Ship* ship, const vector<string>* objectMap)
 		ship->SetWanderTarget(OffsetCoord(x, y));
 	}
 
-	string command;
-	if (FindPath(*ship, objectMap, ship->GetWanderTarget(), command) > 0)
+	int move;
+	if (pathPlanner->FindPath(*ship, distanceFields, dangerMap, ship->GetWanderTarget(), deadline, move) >= 0)
 	{
-		//cerr << "FindPath success, command=" << command << endl;
-		cout << command << endl;
+		//cerr << "FindPath success, command=" << MOVE_COMMANDS[move] << endl;
+		command = MoveCommand(move);
 		return true;
 	}
 
 	return false;
 }
 
-bool CommandFire(Ship* ship, const vector<Ship>& enemyShips)
+bool CommandFire(Ship* ship, const EnemyForecast& forecast, const vector<OffsetCoord>& mines, const vector<Ship>& myShips,
+		Command& command)
 {
 	if (ship->GetHasFired() != 0)
 		return false;
 
-	int shortestShotDistance = MAX_FIRING_RANGE + 1;
-	OffsetCoord shortestShotPos;
-
-	for (unsigned int enemyShipIndex = 0; enemyShipIndex < enemyShips.size(); enemyShipIndex++)
-	{
-		Ship enemyShip = enemyShips[enemyShipIndex];
-
-		for (int t = 1; t <= MAX_FIRING_RANGE; t++)
-		{
-			CubeCoord futureEnemyPos = enemyShip.GetCenterPosCube() + DIRECTIONS[enemyShip.GetRotation()] * (t * enemyShip.GetSpeed());
-			int timeToHit = round(1.0 + ComputeDistance(ship->GetCenterPosCube(), futureEnemyPos) / 3.0);
-
-			if (timeToHit == t && t < shortestShotDistance)
-			{
-				shortestShotDistance = t;
-				shortestShotPos = CubeToOffset(futureEnemyPos);
-			}
-		}
-	}
+	OffsetCoord target;
+	float damage = SolveFiring(*ship, forecast, mines, myShips, target);
 
-	if (shortestShotDistance < MAX_FIRING_RANGE + 1)
+	if (damage >= MIN_FIRING_DAMAGE)
 	{
-		cout << "FIRE " << shortestShotPos.col << " " << shortestShotPos.row << endl;
+		//cerr << "CommandFire: expected damage=" << damage << endl;
+		command = FireCommand(target);
 		ship->SetHasFired(1);
 		return true;
 	}
@@ -1072,55 +4710,55 @@ bool CommandFire(Ship* ship, const vector<Ship>& enemyShips)
 	return false;
 }
 
-bool CommandEmergencyEvading(Ship* ship, const vector<string>* objectMap)
+bool CommandMine(Ship* ship, const EnemyForecast& forecast, const vector<Ship>& myShips, const vector<Ship>& enemyShips,
+		const vector<Barrel>& barrels, const vector<string>* objectMap, Command& command)
 {
-	if (!ship->IsShipPositionLegal(objectMap, 0))
-	{
-		WaitAction waitAction = WaitAction(*ship, nullptr, CubeCoord(0, 0, 0));
-
-		if (waitAction.IsLegal(objectMap))
-		{
-			cout << "WAIT" << endl;
-			return true;
-		}
-
-		PortAction portAction = PortAction(*ship, nullptr, CubeCoord(0, 0, 0));
+	float damage = SolveMining(*ship, forecast, myShips, enemyShips, barrels, objectMap);
 
-		if (portAction.IsLegal(objectMap))
-		{
-			cout << "PORT" << endl;
-			return true;
-		}
+	if (damage >= MIN_MINING_DAMAGE)
+	{
+		//cerr << "CommandMine: expected damage=" << damage << endl;
+		command = MineCommand();
+		ship->SetMineCooldown(COOLDOWN_MINE);
+		return true;
+	}
 
-		StarboardAction starboardAction = StarboardAction(*ship, nullptr, CubeCoord(0, 0, 0));
+	return false;
+}
 
-		if (starboardAction.IsLegal(objectMap))
-		{
-			cout << "STARBOARD" << endl;
-			return true;
-		}
+bool CommandEmergencyEvading(Ship* ship, const vector<string>* objectMap, const DangerMap* dangerMap, Command& command)
+{
+	WaitAction waitAction = WaitAction(*ship, nullptr, nullptr, dangerMap);
 
-		FasterAction fasterAction = FasterAction(*ship, nullptr, CubeCoord(0, 0, 0));
+	if (waitAction.IsLegal(objectMap) && waitAction.GetDamage() < LOW_DAMAGE)
+		return false;
 
-		if (fasterAction.IsLegal(objectMap))
-		{
-			cout << "FASTER" << endl;
-			return true;
-		}
+	// keeping our course hurts: take the move with the least expected damage
+	PortAction portAction = PortAction(*ship, nullptr, nullptr, dangerMap);
+	StarboardAction starboardAction = StarboardAction(*ship, nullptr, nullptr, dangerMap);
+	FasterAction fasterAction = FasterAction(*ship, nullptr, nullptr, dangerMap);
+	SlowerAction slowerAction = SlowerAction(*ship, nullptr, nullptr, dangerMap);
 
-		SlowerAction slowerAction = SlowerAction(*ship, nullptr, CubeCoord(0, 0, 0));
+	Action* actions[] =
+	{ &waitAction, &portAction, &starboardAction, &fasterAction, &slowerAction };
+	Action* bestAction = nullptr;
 
-		if (slowerAction.IsLegal(objectMap))
-		{
-			cout << "SLOWER" << endl;
-			return true;
-		}
+	for (unsigned int i = 0; i < sizeof(actions) / sizeof(actions[0]); i++)
+	{
+		if (actions[i]->IsLegal(objectMap) && (bestAction == nullptr || actions[i]->GetDamage() < bestAction->GetDamage()))
+			bestAction = actions[i];
 	}
 
-	return false;
+	// an illegal WAIT, such as running into a ship, is no option even when it costs no damage
+	if (bestAction == nullptr || (waitAction.IsLegal(objectMap) && bestAction->GetDamage() >= waitAction.GetDamage()))
+		return false;
+
+	command = MoveCommand(bestAction->GetMove());
+	return true;
 }
 
-bool CommandFollow(Ship* ship, const vector<Ship>& enemyShips, const vector<string>* objectMap)
+bool CommandFollow(Ship* ship, const vector<Ship>& enemyShips, DistanceFieldCache* distanceFields, const DangerMap* dangerMap,
+		PathPlanner* pathPlanner, double deadline, Command& command)
 {
 	Ship targetShip;
 	int targetDistance = 15;
@@ -1141,16 +4779,16 @@ bool CommandFollow(Ship* ship, const vector<Ship>& enemyShips, const vector<stri
 	if (targetDistance < 15)
 	{
 		OffsetCoord targetPos;
-		string command;
+		int move;
 
 		targetPos = CubeToOffset(targetShip.GetCenterPosCube() + DIRECTIONS[targetShip.GetRotation()] * (targetShip.GetSpeed() * 2));
 		targetPos.col = max(0, min(targetPos.col, MAP_WIDTH - 2));
 		targetPos.row = max(0, min(targetPos.row, MAP_HEIGHT - 2));
 
-		if (FindPath(*ship, objectMap, targetPos, command) > 0)
+		if (pathPlanner->FindPath(*ship, distanceFields, dangerMap, targetPos, deadline, move) >= 0)
 		{
-			//cerr << "FindPath success, command=" << command << endl;
-			cout << command << endl;
+			//cerr << "FindPath success, command=" << MOVE_COMMANDS[move] << endl;
+			command = MoveCommand(move);
 			return true;
 		}
 	}
@@ -1158,3 +4796,88 @@ bool CommandFollow(Ship* ship, const vector<Ship>& enemyShips, const vector<stri
 	return false;
 }
 
+/**
+ * Reads the entities of one turn into the game state, as the referee sends them. Our ships that were not updated have sunk
+ * and are removed.
+ */
+void ReadTurn(istream& input, int entityCount, vector<Ship>& myShips, EntityTracker& tracker, vector<Barrel>& barrels,
+		vector<OffsetCoord>& mines, vector<string>& objectMap)
+{
+	tracker.BeginTurn();
+
+	for (int i = 0; i < entityCount; i++)
+	{
+		int entityId;
+		string entityType;
+		int x;
+		int y;
+		int arg1;
+		int arg2;
+		int arg3;
+		int arg4;
+		input >> entityId >> entityType >> x >> y >> arg1 >> arg2 >> arg3 >> arg4;
+		input.ignore();
+
+		if (entityType == "SHIP")
+		{
+			Ship* ship;
+
+			if (arg4 == 1)
+			{
+				ship = GetShip(myShips, entityId);
+
+				if (ship == nullptr)
+				{
+					myShips.emplace_back(entityId, x, y, arg1, arg2, arg3);
+					ship = &myShips[myShips.size() - 1];
+				}
+				else
+				{
+					//cerr << "rum1=" << arg3 << endl;
+					ship->Update(x, y, arg1, arg2, arg3);
+				}
+			}
+			else
+			{
+				ship = tracker.UpdateEnemyShip(entityId, x, y, arg1, arg2, arg3);
+			}
+
+			// the bow or the stern of a ship on the border can be outside of the map
+			objectMap[OffsetToIndex(ship->GetCenterPosOffset())] = string("S") + to_string(ship->GetEntityId());
+			if (IsInsideMap(ship->GetFrontPos()))
+				objectMap[OffsetToIndex(ship->GetFrontPos())] = string("S") + to_string(ship->GetEntityId());
+			if (IsInsideMap(ship->GetBackPos()))
+				objectMap[OffsetToIndex(ship->GetBackPos())] = string("S") + to_string(ship->GetEntityId());
+		}
+		else if (entityType == "BARREL")
+		{
+			barrels.emplace_back(Barrel(x, y, arg1));
+			//objectMap[PosToIndex(x, y)] = 'B';
+		}
+		else if (entityType == "CANNONBALL")
+		{
+			tracker.UpdateCannonball(entityId, x, y, arg1, arg2);
+		}
+		else if (entityType == "MINE")
+		{
+			objectMap[PosToIndex(x, y)] = string("M");
+			mines.emplace_back(x, y);
+			//cerr << "objectMap at(" << x << "," << y << ")=" << objectMap.at(PosToIndex(x, y)) << endl;
+		}
+	}
+
+	for (unsigned int i = 0; i < myShips.size(); i++)
+	{
+		//Ship* ship = &myShips.at(i);
+		//int index = OffsetToIndex(ship->GetCenterPosOffset());
+		//cerr << "shipId="<< ship->GetEntityId()<< " index="<<index<< " content=" << objectMap.at(index) << endl;
+
+		if (!myShips[i].GetUpdated())
+		{
+			myShips.erase(myShips.begin() + i);
+			i--;
+		}
+	}
+
+	tracker.EndTurn();
+}
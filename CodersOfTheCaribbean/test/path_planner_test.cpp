@@ -0,0 +1,86 @@
+/*
+ * path_planner_test.cpp
+ *
+ * PathPlanner for Coders of the Caribbean: when the repair of a kept plan cannot reach the destination any more, the full
+ * search from the ship must still have time to.
+ *
+ * build: g++ -std=c++14 -O2 -o path_planner_test path_planner_test.cpp
+ */
+
+#include <cassert>
+
+#define COTC_BENCHMARK
+#include "../source/main.cpp"
+
+//=============================================================
+// MAIN
+//=============================================================
+int main()
+{
+	// the searches log every call
+	cerr.rdbuf(nullptr);
+
+	vector<string> objectMap(MAP_SIZE, "e");
+	DistanceFieldCache distanceFields;
+	PathPlanner planner;
+	OffsetCoord destination(19, 10);
+	Ship ship(1, 3, 10, 0, 2, 100);
+	int move;
+
+	// the first turn makes the plan, the same search gives its states from the first move on
+	TURN_ARENA.Reset();
+	distanceFields.Reset(&objectMap);
+	planner.BeginTurn();
+	assert(planner.FindPath(ship, &distanceFields, nullptr, destination, Now() + 1000, move) == 1);
+
+	bool reached = false;
+	ArenaVector<PathNode> nodes;
+	int pathEnd = SearchPath(ship, 0, &distanceFields, distanceFields.Get(destination), nullptr, destination, Now() + 1000, nodes,
+			reached, nullptr);
+	vector<int> states;
+
+	for (int i = pathEnd; i >= 0; i = nodes[i].parent)
+		states.insert(states.begin(), nodes[i].state);
+
+	const int validMoves = 3;
+	assert(reached && (int) states.size() > validMoves + 2);
+
+	// mines all around where the first moves of the plan end, off the cells the ship goes through until then
+	vector<int> prefixCells;
+
+	for (int i = 0; i <= validMoves; i++)
+	{
+		int pose = StatePose(states[i]);
+		prefixCells.insert(prefixCells.end(), { StateCell(states[i]), KINEMATICS.GetBow(pose), KINEMATICS.GetStern(pose) });
+	}
+
+	const int* endCells = &prefixCells[3 * validMoves];
+
+	for (int cell = 0; cell < MAP_SIZE; cell++)
+	{
+		if (find(prefixCells.begin(), prefixCells.end(), cell) != prefixCells.end())
+			continue;
+
+		if (CellDistance(cell, endCells[0]) <= 2 || CellDistance(cell, endCells[1]) <= 2 || CellDistance(cell, endCells[2]) <= 2)
+			objectMap[cell] = "M";
+	}
+
+	TURN_ARENA.Reset();
+	distanceFields.Reset(&objectMap);
+	planner.BeginTurn();
+
+	// the repair from the end of the valid moves is stuck
+	int end = StateCell(states[validMoves]);
+	Ship repairStart(1, end % MAP_WIDTH, end / MAP_WIDTH, StateRotation(states[validMoves]), StateSpeed(states[validMoves]), 100);
+	ArenaVector<PathNode> repairNodes;
+	SearchPath(repairStart, validMoves, &distanceFields, distanceFields.Get(destination), nullptr, destination, Now() + 1000,
+			repairNodes, reached, nullptr);
+	assert(!reached);
+
+	// the ship has made the first move of the plan, the next ones up to the mines are still legal
+	int start = StateCell(states[0]);
+	Ship nextShip(1, start % MAP_WIDTH, start / MAP_WIDTH, StateRotation(states[0]), StateSpeed(states[0]), 100);
+	assert(planner.FindPath(nextShip, &distanceFields, nullptr, destination, Now() + TURN_TIME, move) == 1);
+
+	return 0;
+}
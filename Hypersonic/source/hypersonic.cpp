@@ -10,10 +10,42 @@
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <bitset>
+#include <cstring>
+#include <chrono>
 //#include <queue>
 
 using namespace std;
 
+const int MAX_MAP_SIZE = 13 * 11; // the map is always 13x11
+const int BFS_QUEUE_SIZE = 256; // power of two above MAX_MAP_SIZE, so the ring buffer wraps with a mask
+
+const int MAX_BOMB_TIMER = 8;
+const int TIME_LAYERS = MAX_BOMB_TIMER + 2; // turns 0 to MAX_BOMB_TIMER, then one layer for all the later turns, without blasts
+const int TIMED_QUEUE_SIZE = 2048; // power of two above MAX_MAP_SIZE * TIME_LAYERS
+const int ANY_SAFE_TILE = -1; // goal of a route to the nearest tile that no bomb reaches
+
+const int MAX_RAY_LENGTH = 12; // tiles from one side of the map to the other
+const int MAX_BOMBS = 32; // bombs on the map at once, the later ones are ignored
+const int MAX_PLAYERS = 4;
+
+const int MOVE_COUNT = 5; // right, left, down, up (the order of the ray tables), then wait
+const int ACTION_COUNT = 2 * MOVE_COUNT; // every move, without and then with a bomb placed first
+const int WAIT_ACTION = MOVE_COUNT - 1;
+
+const bool BEAM_SEARCH_ENABLED = true; // the heuristic decides when this is off or when every plan dies
+const int PLAN_DEPTH = 12;
+const int MIN_BEAM_WIDTH = 32; // the width doubles while there is time left
+const int MAX_BEAM_WIDTH = 1024;
+const int PLAN_HASH_SIZE = 16384; // power of two above ACTION_COUNT * MAX_BEAM_WIDTH
+const double TURN_TIME = 80; // ms, of the 100 the referee allows
+const double FIRST_TURN_TIME = 800;
+
+enum Tile
+{
+	TILE_FLOOR, TILE_WALL, TILE_BOX, TILE_BOX_RANGE, TILE_BOX_BOMB, TILE_ITEM_RANGE, TILE_ITEM_BOMB
+};
+
 struct Player
 {
 	Player() :
@@ -33,20 +65,6 @@ struct Player
 	int explosionRange;
 };
 
-struct Bomb
-{
-	Bomb(int owner, int x, int y, int roundsLeft, int explosionRange) :
-			owner(owner), x(x), y(y), roundsLeft(roundsLeft), explosionRange(explosionRange)
-	{
-	}
-
-	int owner;
-	int x;
-	int y;
-	int roundsLeft;
-	int explosionRange;
-};
-
 struct Item
 {
 	Item() :
@@ -64,6 +82,104 @@ struct Item
 	int type; //1=extra range, 2=extra bomb
 };
 
+/**
+ * Tiles reachable from a start tile, in the order the BFS reached them, and the number of steps to every tile (-1 for the
+ * unreachable ones).
+ */
+struct ReachableTiles
+{
+	ReachableTiles() :
+			count(0)
+	{
+	}
+
+	bool Contains(const int index) const
+	{
+		return distances[index] >= 0;
+	}
+
+	int count;
+	int tiles[MAX_MAP_SIZE];
+	int distances[MAX_MAP_SIZE];
+};
+
+/**
+ * For every tile and direction (right, left, down, up), the tiles a blast from the tile goes through up to the first wall
+ * or the map edge. Walls never change, so the tables are built once.
+ */
+struct RayTables
+{
+	int lengths[MAX_MAP_SIZE][4];
+	unsigned char tiles[MAX_MAP_SIZE][4][MAX_RAY_LENGTH];
+};
+
+/**
+ * Every bomb on the map resolved, turns counted from now: turn 1 is the blast right after this turn's move.
+ */
+struct Explosions
+{
+	int blastTurns[MAX_MAP_SIZE]; // bit t is set when a blast covers the tile on turn t
+	int boxTurns[MAX_MAP_SIZE]; // turn the box of the tile is destroyed, 0 if it stays
+	int itemTurns[MAX_MAP_SIZE]; // turn the item of the tile is destroyed, 0 if it stays (items dropped by boxes too)
+};
+
+struct BombState
+{
+	unsigned char owner;
+	unsigned char index;
+	unsigned char timer; // turns until it goes off
+	unsigned char range;
+};
+
+struct PlayerState
+{
+	PlayerState() :
+			index(0), bombs(0), range(0), alive(false), score(0)
+	{
+	}
+
+	PlayerState(int index, int bombs, int range) :
+			index(index), bombs(bombs), range(range), alive(true), score(0)
+	{
+	}
+
+	unsigned char index;
+	unsigned char bombs; // bombs left to place
+	unsigned char range;
+	bool alive;
+	short score; // boxes destroyed
+};
+
+/**
+ * Everything a turn changes, in fixed arrays so a state is copied with a single memcpy. Players are indexed by their id,
+ * the bombs are packed at the front of their array.
+ */
+struct GameState
+{
+	GameState() :
+			bombCount(0)
+	{
+		memset(tiles, TILE_FLOOR, sizeof(tiles));
+		memset(bombSlots, -1, sizeof(bombSlots));
+	}
+
+	unsigned char tiles[MAX_MAP_SIZE];
+	signed char bombSlots[MAX_MAP_SIZE]; // slot of the bomb on each tile, -1 for none
+	BombState bombs[MAX_BOMBS];
+	PlayerState players[MAX_PLAYERS];
+	int bombCount;
+};
+
+/**
+ * A beam entry: the state after the actions of the plan, and its evaluation.
+ */
+struct PlanNode
+{
+	GameState state;
+	unsigned char actions[PLAN_DEPTH];
+	float score;
+};
+
 //==========================================================================================================
 //==========================================================================================================
 //
@@ -86,77 +202,501 @@ float ComputeDistance(const int x1, const int y1, const int x2, const int y2)
 	return sqrt(pow(x2 - x1, 2) + pow(y2 - y1, 2));
 }
 
-bool FillBombRangeInfo(const int posIndex, const Bomb &bomb, int *map)
+/**
+ * Writes the tiles next to the index that are inside the map (right, left, down, up) and returns how many there are.
+ */
+int ComputeNeighbours(const int index, const int mapWidth, const int mapSize, int* neighbours)
+{
+	int count = 0;
+
+	if ((index + 1) % mapWidth != 0)
+		neighbours[count++] = index + 1;
+	if (index % mapWidth != 0)
+		neighbours[count++] = index - 1;
+	if (index + mapWidth < mapSize)
+		neighbours[count++] = index + mapWidth;
+	if (index - mapWidth >= 0)
+		neighbours[count++] = index - mapWidth;
+
+	return count;
+}
+
+bool IsBox(const int tile)
+{
+	return tile == TILE_BOX || tile == TILE_BOX_RANGE || tile == TILE_BOX_BOMB;
+}
+
+/**
+ * returns the first turn a blast covers the tile, 0 if none does
+ */
+int ComputeFirstBlastTurn(const int blastTurns)
 {
-	switch (map[posIndex])
+	return blastTurns == 0 ? 0 : __builtin_ctz(blastTurns);
+}
+
+void BuildRayTables(const unsigned char* tiles, const int mapWidth, const int mapSize, RayTables &rays)
+{
+	const int stepX[4] = { 1, -1, 0, 0 };
+	const int stepY[4] = { 0, 0, 1, -1 };
+	int mapHeight = mapSize / mapWidth;
+
+	for (int index = 0; index < mapSize; index++)
 	{
-	case -1:
-		map[posIndex] = -2;
-		return true;
-	case 0:
-		map[posIndex] = bomb.roundsLeft;
-		return false;
+		int x, y;
+		ComputePos(index, mapWidth, x, y);
+
+		for (int d = 0; d < 4; d++)
+		{
+			int length = 0;
+			int rayX = x + stepX[d];
+			int rayY = y + stepY[d];
+
+			while (rayX >= 0 && rayX < mapWidth && rayY >= 0 && rayY < mapHeight && length < MAX_RAY_LENGTH
+					&& tiles[ComputeIndex(rayX, rayY, mapWidth)] != TILE_WALL)
+			{
+				rays.tiles[index][d][length++] = ComputeIndex(rayX, rayY, mapWidth);
+				rayX += stepX[d];
+				rayY += stepY[d];
+			}
+
+			rays.lengths[index][d] = length;
+		}
 	}
+}
 
-	return false;
+bool AddBomb(GameState &state, const int owner, const int index, const int timer, const int range)
+{
+	if (state.bombCount == MAX_BOMBS || state.bombSlots[index] >= 0)
+		return false;
+
+	BombState &bomb = state.bombs[state.bombCount];
+	bomb.owner = owner;
+	bomb.index = index;
+	bomb.timer = timer;
+	bomb.range = range;
+	state.bombSlots[index] = state.bombCount++;
+
+	return true;
 }
 
-vector<int> ComputeReachableTiles(const int x, const int y, const int* map, const int mapWidth, const int mapSize)
+/**
+ * Counts the bombs down by one turn and plays out the ones that go off. A blast stops at the first box, item or bomb of
+ * each ray and hits it; a bomb that is hit goes off on the same turn. Destroyed boxes and items only disappear at the end
+ * of the turn, so they still stop the other blasts of the turn, and a box leaves its item behind. Every box scores a point
+ * for each player whose blast reaches it, and players in a blast are eliminated. When explosions is set, what the blasts
+ * reach is recorded there as the given turn.
+ */
+void ExplodeBombs(GameState &state, const RayTables &rays, const int turn, Explosions* explosions)
 {
-	vector<int> result;
-	vector<int> openTiles;
+	int chain[MAX_BOMBS];
+	int chainCount = 0;
 
-	int startIndex = ComputeIndex(x, y, mapWidth);
-	result.push_back(startIndex);
-	openTiles.push_back(startIndex);
+	for (int s = 0; s < state.bombCount; s++)
+	{
+		if (--state.bombs[s].timer == 0)
+			chain[chainCount++] = s;
+	}
+
+	if (chainCount == 0)
+		return;
+
+	bitset<MAX_MAP_SIZE> blasted;
+	int hitTiles[MAX_BOMBS * 4];
+	int hitOwners[MAX_BOMBS * 4];
+	int hitCount = 0;
+
+	// the chain grows while it is walked, every bomb joins it once
+	for (int i = 0; i < chainCount; i++)
+	{
+		const BombState &bomb = state.bombs[chain[i]];
+		blasted.set(bomb.index);
+
+		for (int d = 0; d < 4; d++)
+		{
+			int length = min(rays.lengths[bomb.index][d], bomb.range - 1);
+
+			for (int k = 0; k < length; k++)
+			{
+				int index = rays.tiles[bomb.index][d][k];
+				blasted.set(index);
+
+				if (state.tiles[index] != TILE_FLOOR)
+				{
+					int h = 0;
+
+					while (h < hitCount && hitTiles[h] != index)
+						h++;
+
+					if (h == hitCount)
+					{
+						hitTiles[hitCount] = index;
+						hitOwners[hitCount++] = 0;
+					}
+
+					hitOwners[h] |= 1 << bomb.owner;
+					break;
+				}
 
-	while (!openTiles.empty())
+				int slot = state.bombSlots[index];
+
+				if (slot >= 0)
+				{
+					if (state.bombs[slot].timer > 0)
+					{
+						state.bombs[slot].timer = 0;
+						chain[chainCount++] = slot;
+					}
+					break;
+				}
+			}
+		}
+	}
+
+	for (int h = 0; h < hitCount; h++)
 	{
-		int currentIndex = openTiles.front();
-		openTiles.erase(openTiles.begin());
+		int index = hitTiles[h];
 
-		int neighbourIndex = currentIndex + 1;
-		if (neighbourIndex < mapSize && neighbourIndex % mapWidth != 0 && map[neighbourIndex] >= 0
-				&& find(result.begin(), result.end(), neighbourIndex) == result.end())
+		if (IsBox(state.tiles[index]))
 		{
-			result.push_back(neighbourIndex);
-			openTiles.push_back(neighbourIndex);
+			for (int p = 0; p < MAX_PLAYERS; p++)
+			{
+				if (hitOwners[h] & (1 << p))
+					state.players[p].score++;
+			}
+
+			if (explosions != NULL)
+				explosions->boxTurns[index] = turn;
 		}
+		else if (explosions != NULL)
+			explosions->itemTurns[index] = turn;
 
-		neighbourIndex = currentIndex - 1;
-		if (neighbourIndex >= 0 && neighbourIndex % mapWidth != mapWidth - 1 && map[neighbourIndex] >= 0
-				&& find(result.begin(), result.end(), neighbourIndex) == result.end())
+		switch (state.tiles[index])
 		{
-			result.push_back(neighbourIndex);
-			openTiles.push_back(neighbourIndex);
+		case TILE_BOX_RANGE:
+			state.tiles[index] = TILE_ITEM_RANGE;
+			break;
+		case TILE_BOX_BOMB:
+			state.tiles[index] = TILE_ITEM_BOMB;
+			break;
+		default:
+			state.tiles[index] = TILE_FLOOR;
 		}
+	}
+
+	// the bombs that went off go back to their owners
+	int bombCount = 0;
+
+	for (int s = 0; s < state.bombCount; s++)
+	{
+		const BombState &bomb = state.bombs[s];
 
-		neighbourIndex = currentIndex + mapWidth;
-		if (neighbourIndex < mapSize && map[neighbourIndex] >= 0 && find(result.begin(), result.end(), neighbourIndex) == result.end())
+		if (bomb.timer == 0)
 		{
-			result.push_back(neighbourIndex);
-			openTiles.push_back(neighbourIndex);
+			state.players[bomb.owner].bombs++;
+			state.bombSlots[bomb.index] = -1;
 		}
+		else
+		{
+			state.bombs[bombCount] = bomb;
+			state.bombSlots[bomb.index] = bombCount++;
+		}
+	}
+
+	state.bombCount = bombCount;
+
+	for (int p = 0; p < MAX_PLAYERS; p++)
+	{
+		if (state.players[p].alive && blasted[state.players[p].index])
+			state.players[p].alive = false;
+	}
 
-		neighbourIndex = currentIndex - mapWidth;
-		if (neighbourIndex >= 0 && map[neighbourIndex] >= 0 && find(result.begin(), result.end(), neighbourIndex) == result.end())
+	if (explosions != NULL)
+	{
+		for (int i = 0; i < MAX_MAP_SIZE; i++)
 		{
-			result.push_back(neighbourIndex);
-			openTiles.push_back(neighbourIndex);
+			if (blasted[i])
+				explosions->blastTurns[i] |= 1 << turn;
 		}
 	}
+}
+
+/**
+ * Plays the bombs of the state out until the last one has gone off, without the players doing anything.
+ */
+void ResolveExplosions(const GameState &state, const RayTables &rays, Explosions &result)
+{
+	GameState future;
+	memcpy(&future, &state, sizeof(GameState));
 
-	return result;
+	fill(result.blastTurns, result.blastTurns + MAX_MAP_SIZE, 0);
+	fill(result.boxTurns, result.boxTurns + MAX_MAP_SIZE, 0);
+	fill(result.itemTurns, result.itemTurns + MAX_MAP_SIZE, 0);
+
+	for (int turn = 1; turn <= MAX_BOMB_TIMER && future.bombCount > 0; turn++)
+		ExplodeBombs(future, rays, turn, &result);
 }
 
-void EvaluateBombPositions(const int mapWidth, const int mapSize, const int* map, const Player &player, int &bestTileIndex,
-		int &secondTileIndex, float &bestTilePriority, float &secondTilePriority)
+/**
+ * Breadth-first search over (tile, turn) on the blasts of the state, like ComputeFirstStep: can the player reach a tile no
+ * later blast covers without being in a blast when it goes off? Boxes and bombs are taken to block for good.
+ */
+bool CanEscape(const GameState &state, const RayTables &rays, const int playerId)
+{
+	Explosions explosions;
+	ResolveExplosions(state, rays, explosions);
+
+	int startIndex = state.players[playerId].index;
+
+	if ((explosions.blastTurns[startIndex] >> 1) == 0)
+		return true;
+
+	bitset<MAX_MAP_SIZE * TIME_LAYERS> visited;
+	int openStates[TIMED_QUEUE_SIZE];
+	unsigned int head = 0;
+	unsigned int tail = 0;
+
+	visited.set(startIndex * TIME_LAYERS);
+	openStates[tail++ & (TIMED_QUEUE_SIZE - 1)] = startIndex * TIME_LAYERS;
+
+	while (head != tail)
+	{
+		int openState = openStates[head++ & (TIMED_QUEUE_SIZE - 1)];
+		int currentIndex = openState / TIME_LAYERS;
+		int turn = openState % TIME_LAYERS;
+
+		if ((explosions.blastTurns[currentIndex] >> (turn + 1)) == 0)
+			return true;
+
+		int nextTurn = min(turn + 1, TIME_LAYERS - 1);
+
+		for (int d = 0; d < MOVE_COUNT; d++)
+		{
+			int nextIndex = currentIndex;
+
+			if (d != WAIT_ACTION)
+			{
+				if (rays.lengths[currentIndex][d] == 0)
+					continue;
+
+				nextIndex = rays.tiles[currentIndex][d][0];
+
+				if (IsBox(state.tiles[nextIndex]) || state.bombSlots[nextIndex] >= 0)
+					continue;
+			}
+
+			int nextState = nextIndex * TIME_LAYERS + nextTurn;
+
+			if ((explosions.blastTurns[nextIndex] & (1 << nextTurn)) || visited[nextState])
+				continue;
+
+			visited.set(nextState);
+			openStates[tail++ & (TIMED_QUEUE_SIZE - 1)] = nextState;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * CanEscape for a bomb the player would place on the tile after walking there: the bombs of the map count down during the
+ * walk, then the new bomb is added. It gets one turn less than a placed bomb really has, to stay on the safe side.
+ */
+bool CanEscapeBomb(const GameState &state, const RayTables &rays, const int playerId, const int index, const int distance)
+{
+	GameState future;
+	memcpy(&future, &state, sizeof(GameState));
+
+	for (int i = 0; i < distance && future.bombCount > 0; i++)
+		ExplodeBombs(future, rays, 0, NULL);
+
+	PlayerState &player = future.players[playerId];
+	player.index = index;
+
+	if (!AddBomb(future, playerId, index, MAX_BOMB_TIMER, player.range))
+		return false;
+
+	return CanEscape(future, rays, playerId);
+}
+
+/**
+ * Plays one turn with an action per player (the move plus MOVE_COUNT to place a bomb first), in the order of the referee:
+ * bombs are placed where the players stand, the players move, the bombs count down and go off, then the players pick up
+ * the items they stand on. Boxes, walls and bombs block moves, except the bomb a player leaves. Eliminated players stay
+ * out: there is no respawn in Hypersonic.
+ */
+void Step(GameState &state, const int* actions, const RayTables &rays)
+{
+	for (int p = 0; p < MAX_PLAYERS; p++)
+	{
+		PlayerState &player = state.players[p];
+
+		// one turn more, because the countdown of this turn skips the new bomb
+		if (player.alive && actions[p] >= MOVE_COUNT && player.bombs > 0
+				&& AddBomb(state, p, player.index, MAX_BOMB_TIMER + 1, player.range))
+			player.bombs--;
+	}
+
+	for (int p = 0; p < MAX_PLAYERS; p++)
+	{
+		PlayerState &player = state.players[p];
+		int direction = actions[p] % MOVE_COUNT;
+
+		if (!player.alive || direction == MOVE_COUNT - 1 || rays.lengths[player.index][direction] == 0)
+			continue;
+
+		int index = rays.tiles[player.index][direction][0];
+
+		if (!IsBox(state.tiles[index]) && state.bombSlots[index] < 0)
+			player.index = index;
+	}
+
+	ExplodeBombs(state, rays, 0, NULL);
+
+	for (int p = 0; p < MAX_PLAYERS; p++)
+	{
+		PlayerState &player = state.players[p];
+
+		if (!player.alive)
+			continue;
+
+		if (state.tiles[player.index] == TILE_ITEM_RANGE)
+			player.range++;
+		else if (state.tiles[player.index] == TILE_ITEM_BOMB)
+			player.bombs++;
+	}
+
+	// players on the same item all get it
+	for (int p = 0; p < MAX_PLAYERS; p++)
+	{
+		if (state.players[p].alive)
+			state.tiles[state.players[p].index] = TILE_FLOOR;
+	}
+}
+
+/**
+ * Every tile of the map legend gets the turn of the first blast that reaches it, and every box a blast reaches is marked.
+ */
+void FillBlastTurns(const Explosions &explosions, const int mapSize, int* map)
+{
+	for (int i = 0; i < mapSize; i++)
+	{
+		if (explosions.blastTurns[i] == 0)
+			continue;
+
+		int turn = ComputeFirstBlastTurn(explosions.blastTurns[i]);
+
+		if (map[i] == 0 || map[i] > turn)
+			map[i] = turn;
+		else if (map[i] == -1)
+			map[i] = -2;
+	}
+}
+
+/**
+ * Breadth-first search over the free tiles, with a fixed ring buffer as the queue and a bitset of the visited tiles.
+ */
+void ComputeReachableTiles(const int x, const int y, const int* map, const int mapWidth, const int mapSize, ReachableTiles &result)
+{
+	bitset<MAX_MAP_SIZE> visited;
+	int openTiles[BFS_QUEUE_SIZE];
+	unsigned int head = 0;
+	unsigned int tail = 0;
+
+	fill(result.distances, result.distances + mapSize, -1);
+	result.count = 0;
+
+	int startIndex = ComputeIndex(x, y, mapWidth);
+	visited.set(startIndex);
+	result.distances[startIndex] = 0;
+	openTiles[tail++ & (BFS_QUEUE_SIZE - 1)] = startIndex;
+
+	while (head != tail)
+	{
+		int currentIndex = openTiles[head++ & (BFS_QUEUE_SIZE - 1)];
+		result.tiles[result.count++] = currentIndex;
+
+		int neighbours[4];
+		int neighbourCount = ComputeNeighbours(currentIndex, mapWidth, mapSize, neighbours);
+
+		for (int i = 0; i < neighbourCount; i++)
+		{
+			int neighbourIndex = neighbours[i];
+
+			if (map[neighbourIndex] >= 0 && !visited[neighbourIndex])
+			{
+				visited.set(neighbourIndex);
+				result.distances[neighbourIndex] = result.distances[currentIndex] + 1;
+				openTiles[tail++ & (BFS_QUEUE_SIZE - 1)] = neighbourIndex;
+			}
+		}
+	}
+}
+
+/**
+ * Breadth-first search over (tile, turn): a tile in the range of bombs can be crossed, except on the turns they go off
+ * (blastTurns from ResolveExplosions). Waiting on a tile is a move too. The goal is a tile index, or ANY_SAFE_TILE for the
+ * nearest tile out of every blast.
+ * returns the tile of the first step of the shortest safe route (the start tile to wait), -1 if there is none
+ */
+int ComputeFirstStep(const int startIndex, const int goalIndex, const int* map, const int* blastTurns, const int mapWidth,
+		const int mapSize)
 {
-	vector<int> reachableTiles = ComputeReachableTiles(player.x, player.y, map, mapWidth, mapSize);
+	bitset<MAX_MAP_SIZE * TIME_LAYERS> visited;
+	int openStates[TIMED_QUEUE_SIZE];
+	int firstSteps[MAX_MAP_SIZE * TIME_LAYERS];
+	unsigned int head = 0;
+	unsigned int tail = 0;
+
+	visited.set(startIndex * TIME_LAYERS);
+	firstSteps[startIndex * TIME_LAYERS] = startIndex;
+	openStates[tail++ & (TIMED_QUEUE_SIZE - 1)] = startIndex * TIME_LAYERS;
 
-	for (unsigned int i = 0; i < reachableTiles.size(); i++)
+	while (head != tail)
 	{
-		int index = reachableTiles[i];
+		int state = openStates[head++ & (TIMED_QUEUE_SIZE - 1)];
+		int currentIndex = state / TIME_LAYERS;
+		int turn = state % TIME_LAYERS;
+
+		// the player has to be able to stay on the goal, so a goal in a blast only counts once its last blast is over
+		bool safeToStay = map[currentIndex] >= 0 && (blastTurns[currentIndex] >> (turn + 1)) == 0;
+
+		if ((currentIndex == goalIndex && safeToStay) || (goalIndex == ANY_SAFE_TILE && blastTurns[currentIndex] == 0))
+			return firstSteps[state];
+
+		int nextTiles[5];
+		int nextTileCount = ComputeNeighbours(currentIndex, mapWidth, mapSize, nextTiles);
+		nextTiles[nextTileCount++] = currentIndex;
+
+		int nextTurn = min(turn + 1, TIME_LAYERS - 1);
+
+		for (int i = 0; i < nextTileCount; i++)
+		{
+			int nextIndex = nextTiles[i];
+			int nextState = nextIndex * TIME_LAYERS + nextTurn;
+
+			// bombs (the one the player may stand on too), boxes and walls block, blasts only on their turns
+			if (map[nextIndex] < 0 || ((blastTurns[nextIndex] >> nextTurn) & 1) || visited[nextState])
+				continue;
+
+			visited.set(nextState);
+			firstSteps[nextState] = (turn == 0) ? nextIndex : firstSteps[state];
+			openStates[tail++ & (TIMED_QUEUE_SIZE - 1)] = nextState;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * Only the tiles the player can still get away from once its bomb is there are candidates.
+ */
+void EvaluateBombPositions(const int mapWidth, const int mapSize, const int* map, const Player &player,
+		const ReachableTiles &reachableTiles, const GameState &state, const RayTables &rays, int &bestTileIndex,
+		int &secondTileIndex, float &bestTilePriority, float &secondTilePriority)
+{
+	for (int i = 0; i < reachableTiles.count; i++)
+	{
+		int index = reachableTiles.tiles[i];
 
 		if (map[index] != 0)
 			continue;
@@ -224,11 +764,9 @@ void EvaluateBombPositions(const int mapWidth, const int mapSize, const int* map
 			}
 		}
 
-		if (priority > 0)
+		if (priority > 0 && CanEscapeBomb(state, rays, player.owner, index, reachableTiles.distances[index]))
 		{
-			int cX, cY;
-			ComputePos(index, mapWidth, cX, cY);
-			float distance = ComputeDistance(player.x, player.y, cX, cY);
+			float distance = reachableTiles.distances[index];
 			float score;
 
 			if (distance == 0)
@@ -260,12 +798,11 @@ void EvaluateBombPositions(const int mapWidth, const int mapSize, const int* map
 	}
 }
 
-bool ComputeNearestItemPos(const int itemType, vector<Item> &items, const Player &player, const int* map, const int mapWidth,
-		const int mapSize, int &resultX, int &resultY)
+bool ComputeNearestItemPos(const int itemType, vector<Item> &items, const ReachableTiles &reachableTiles, const int mapWidth,
+		int &resultX, int &resultY)
 {
 	Item nearestItem;
-	float shortestDistance = 500;
-	vector<int> reachableTiles = ComputeReachableTiles(player.x, player.y, map, mapWidth, mapSize);
+	int shortestDistance = 500;
 	bool itemFound = false;
 
 	for (unsigned int i = 0; i < items.size(); i++)
@@ -273,9 +810,9 @@ bool ComputeNearestItemPos(const int itemType, vector<Item> &items, const Player
 		Item &item = items[i];
 		int itemPosIndex = ComputeIndex(item.x, item.y, mapWidth);
 
-		if (item.type == itemType && find(reachableTiles.begin(), reachableTiles.end(), itemPosIndex) != reachableTiles.end())
+		if (item.type == itemType && reachableTiles.Contains(itemPosIndex))
 		{
-			float distance = ComputeDistance(player.x, player.y, item.x, item.y);
+			int distance = reachableTiles.distances[itemPosIndex];
 
 			if (distance < shortestDistance)
 			{
@@ -298,6 +835,304 @@ bool ComputeNearestItemPos(const int itemType, vector<Item> &items, const Player
 //==========================================================================================================
 //==========================================================================================================
 
+double ComputeTime()
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Boxes the player destroyed or will destroy with the bombs on the map, the bombs and range it collected, the tiles it can
+ * walk to and how far the nearest box no bomb aims at is.
+ */
+float EvaluatePlanState(const GameState &state, const RayTables &rays, const int playerId)
+{
+	const PlayerState &player = state.players[playerId];
+	bitset<MAX_MAP_SIZE> targetedBoxes;
+	int pendingBoxes = 0;
+	int bombCapacity = player.bombs;
+
+	for (int b = 0; b < state.bombCount; b++)
+	{
+		const BombState &bomb = state.bombs[b];
+
+		if (bomb.owner == playerId)
+			bombCapacity++;
+
+		for (int d = 0; d < 4; d++)
+		{
+			int length = min(rays.lengths[bomb.index][d], bomb.range - 1);
+
+			for (int k = 0; k < length; k++)
+			{
+				int index = rays.tiles[bomb.index][d][k];
+
+				if (IsBox(state.tiles[index]) && !targetedBoxes[index])
+				{
+					targetedBoxes.set(index);
+
+					if (bomb.owner == playerId)
+						pendingBoxes++;
+				}
+
+				if (state.tiles[index] != TILE_FLOOR || state.bombSlots[index] >= 0)
+					break;
+			}
+		}
+	}
+
+	bitset<MAX_MAP_SIZE> visited;
+	int openTiles[BFS_QUEUE_SIZE];
+	int distances[MAX_MAP_SIZE];
+	unsigned int head = 0;
+	unsigned int tail = 0;
+	int boxDistance = -1;
+
+	visited.set(player.index);
+	distances[player.index] = 0;
+	openTiles[tail++ & (BFS_QUEUE_SIZE - 1)] = player.index;
+
+	while (head != tail)
+	{
+		int currentIndex = openTiles[head++ & (BFS_QUEUE_SIZE - 1)];
+
+		for (int d = 0; d < 4; d++)
+		{
+			if (rays.lengths[currentIndex][d] == 0)
+				continue;
+
+			int nextIndex = rays.tiles[currentIndex][d][0];
+
+			if (IsBox(state.tiles[nextIndex]))
+			{
+				if (boxDistance < 0 && !targetedBoxes[nextIndex])
+					boxDistance = distances[currentIndex];
+			}
+			else if (state.bombSlots[nextIndex] < 0 && !visited[nextIndex])
+			{
+				visited.set(nextIndex);
+				distances[nextIndex] = distances[currentIndex] + 1;
+				openTiles[tail++ & (BFS_QUEUE_SIZE - 1)] = nextIndex;
+			}
+		}
+	}
+
+	float score = 100 * player.score + 50 * pendingBoxes;
+	score += 30 * min((int) player.range, 6) + 40 * min(bombCapacity, 4);
+	score += min((int) tail, 30);
+	score -= 3 * (boxDistance < 0 ? 20 : boxDistance);
+
+	return score;
+}
+
+/**
+ * Whether the player may take the action: a bomb needs one left and no bomb on the tile, a move needs a free tile.
+ */
+bool IsActionValid(const GameState &state, const RayTables &rays, const int playerId, const int action)
+{
+	const PlayerState &player = state.players[playerId];
+
+	if (action >= MOVE_COUNT && (player.bombs == 0 || state.bombSlots[player.index] >= 0))
+		return false;
+
+	int direction = action % MOVE_COUNT;
+
+	if (direction == WAIT_ACTION)
+		return true;
+
+	if (rays.lengths[player.index][direction] == 0)
+		return false;
+
+	int index = rays.tiles[player.index][direction][0];
+
+	return !IsBox(state.tiles[index]) && state.bombSlots[index] < 0;
+}
+
+/**
+ * Plays our action while the opponents wait. returns false if the player does not live through it or is left without an
+ * escape from the bombs.
+ */
+bool PlayPlanAction(GameState &state, const RayTables &rays, const int playerId, const int action)
+{
+	int actions[MAX_PLAYERS];
+	fill(actions, actions + MAX_PLAYERS, (int) WAIT_ACTION);
+	actions[playerId] = action;
+
+	Step(state, actions, rays);
+
+	return state.players[playerId].alive && CanEscape(state, rays, playerId);
+}
+
+unsigned int ComputePlanHash(const GameState &state, const int playerId)
+{
+	const PlayerState &player = state.players[playerId];
+	unsigned int hash = 2166136261u;
+
+	hash = (hash ^ player.index) * 16777619u;
+	hash = (hash ^ (player.bombs | player.range << 8 | player.score << 16)) * 16777619u;
+
+	for (int b = 0; b < state.bombCount; b++)
+		hash = (hash ^ (state.bombs[b].index | state.bombs[b].timer << 8)) * 16777619u;
+
+	return hash;
+}
+
+bool CompareNodeScores(const PlanNode &a, const PlanNode &b)
+{
+	return a.score > b.score;
+}
+
+/**
+ * One beam search of the given width over our actions. Children that reach the same position, bombs and score as an
+ * earlier child are dropped. returns false if the deadline cut it short, the best plan is written otherwise (its length
+ * is 0 if no plan survives a single turn).
+ */
+bool RunBeamSearch(const GameState &root, const RayTables &rays, const int playerId, const int width, const double deadline,
+		vector<PlanNode> &beam, vector<PlanNode> &children, vector<int> &plan, float &planScore)
+{
+	beam.resize(1);
+	memcpy(&beam[0].state, &root, sizeof(GameState));
+	beam[0].score = 0;
+
+	int depth = 0;
+
+	for (; depth < PLAN_DEPTH; depth++)
+	{
+		unsigned int hashes[PLAN_HASH_SIZE] = { };
+		children.clear();
+
+		for (unsigned int n = 0; n < beam.size(); n++)
+		{
+			if (ComputeTime() > deadline)
+				return false;
+
+			for (int action = 0; action < ACTION_COUNT; action++)
+			{
+				if (!IsActionValid(beam[n].state, rays, playerId, action))
+					continue;
+
+				children.push_back(beam[n]);
+				PlanNode &child = children.back();
+				child.actions[depth] = action;
+
+				if (!PlayPlanAction(child.state, rays, playerId, action))
+				{
+					children.pop_back();
+					continue;
+				}
+
+				unsigned int hash = ComputePlanHash(child.state, playerId) | 1;
+				unsigned int slot = hash & (PLAN_HASH_SIZE - 1);
+
+				while (hashes[slot] != 0 && hashes[slot] != hash)
+					slot = (slot + 1) & (PLAN_HASH_SIZE - 1);
+
+				if (hashes[slot] == hash)
+				{
+					children.pop_back();
+					continue;
+				}
+
+				hashes[slot] = hash;
+				child.score = EvaluatePlanState(child.state, rays, playerId);
+			}
+		}
+
+		if (children.empty())
+			break;
+
+		if ((int) children.size() > width)
+		{
+			nth_element(children.begin(), children.begin() + width, children.end(), CompareNodeScores);
+			children.resize(width);
+		}
+
+		beam.swap(children);
+	}
+
+	plan.clear();
+
+	if (depth == 0)
+		return true;
+
+	const PlanNode* best = &beam[0];
+
+	for (unsigned int n = 1; n < beam.size(); n++)
+	{
+		if (beam[n].score > best->score)
+			best = &beam[n];
+	}
+
+	plan.assign(best->actions, best->actions + depth);
+	planScore = best->score;
+
+	return true;
+}
+
+/**
+ * Replays what is left of last turn's plan, padded with waits, and writes its evaluation. returns false if it no longer
+ * works.
+ */
+bool EvaluateCarriedPlan(const GameState &root, const RayTables &rays, const int playerId, vector<int> &plan, float &planScore)
+{
+	if (plan.empty())
+		return false;
+
+	GameState state;
+	memcpy(&state, &root, sizeof(GameState));
+
+	while ((int) plan.size() < PLAN_DEPTH)
+		plan.push_back(WAIT_ACTION);
+
+	for (unsigned int i = 0; i < plan.size(); i++)
+	{
+		if (!IsActionValid(state, rays, playerId, plan[i]) || !PlayPlanAction(state, rays, playerId, plan[i]))
+			return false;
+	}
+
+	planScore = EvaluatePlanState(state, rays, playerId);
+
+	return true;
+}
+
+/**
+ * Beam searches of growing width until the deadline, against what is left of the previous plan, which is replaced by the
+ * best plan found. returns false if no plan survives.
+ */
+bool SearchPlan(const GameState &root, const RayTables &rays, const int playerId, const double deadline,
+		vector<PlanNode> &beam, vector<PlanNode> &children, vector<int> &plan)
+{
+	float bestScore = 0;
+
+	if (!EvaluateCarriedPlan(root, rays, playerId, plan, bestScore))
+		plan.clear();
+
+	for (int width = MIN_BEAM_WIDTH; width <= MAX_BEAM_WIDTH; width *= 2)
+	{
+		vector<int> newPlan;
+		float newScore = 0;
+
+		if (!RunBeamSearch(root, rays, playerId, width, deadline, beam, children, newPlan, newScore))
+			break;
+
+		// a plan that dies before the end of the search only ends shorter
+		if (newPlan.size() > plan.size() || (newPlan.size() == plan.size() && newScore > bestScore))
+		{
+			plan = newPlan;
+			bestScore = newScore;
+		}
+	}
+
+	return !plan.empty();
+}
+
+//==========================================================================================================
+//==========================================================================================================
+//
+//==========================================================================================================
+//==========================================================================================================
+
+// the tests include this file and bring their own main
+#ifndef HYPERSONIC_TEST
 /**
  *
  * map legend:
@@ -306,7 +1141,7 @@ bool ComputeNearestItemPos(const int itemType, vector<Item> &items, const Player
  * 	"-2" = box that is in range of a bomb
  * 	"-3" = bomb
  * 	"-4" = wall
- * 	">1" = empty tile that is in explosion range of a bomb, number is the number of turns until the bomb explodes
+ * 	">1" = empty tile that is in explosion range of a bomb, number is the number of turns until the first blast reaches it
  **/
 int main()
 {
@@ -321,7 +1156,19 @@ int main()
 	int _map[_mapSize];
 
 	Player _player;
+	GameState _state;
 	vector<Item> _items;
+	ReachableTiles _reachableTiles;
+	RayTables _rayTables;
+	Explosions _explosions;
+	bool _rayTablesBuilt = false;
+
+	// the plan is carried from one turn to the next, the beams are kept to reuse their memory
+	vector<int> _plan;
+	vector<PlanNode> _beam;
+	vector<PlanNode> _children;
+	_beam.reserve(MAX_BEAM_WIDTH);
+	_children.reserve(ACTION_COUNT * MAX_BEAM_WIDTH);
 
 	bool _extraBombItemAvailable = false;
 	bool _extraRangeItemAvailable = false;
@@ -349,12 +1196,23 @@ int main()
 				{
 				case '.':
 					_map[index] = 0;
+					_state.tiles[index] = TILE_FLOOR;
 					break;
 				case 'X':
 					_map[index] = -4;
+					_state.tiles[index] = TILE_WALL;
+					break;
+				case '1':
+					_map[index] = -1;
+					_state.tiles[index] = TILE_BOX_RANGE;
+					break;
+				case '2':
+					_map[index] = -1;
+					_state.tiles[index] = TILE_BOX_BOMB;
 					break;
 				default:
 					_map[index] = -1;
+					_state.tiles[index] = TILE_BOX;
 				}
 			}
 		}
@@ -375,6 +1233,9 @@ int main()
 
 			if (entityType == 0) //player
 			{
+				if (owner < MAX_PLAYERS)
+					_state.players[owner] = PlayerState(ComputeIndex(x, y, _mapWidth), param1, param2);
+
 				if (owner == _myId)
 				{
 					_player = Player(owner, x, y, param1, param2);
@@ -382,35 +1243,13 @@ int main()
 			}
 			else if (entityType == 1) //bomb
 			{
-				Bomb bomb = Bomb(owner, x, y, param1, param2);
-				int index = ComputeIndex(x, y, _mapWidth);
-				int newIndex;
-				bool up = false, down = false, left = false, right = false;
-
-				_map[index] = -3;
-
-				for (int r = 1; r < param2; r++)
-				{
-					newIndex = index + r;
-					if (!right && newIndex < _mapSize && newIndex % _mapWidth != 0)
-						right = FillBombRangeInfo(newIndex, bomb, _map);
-
-					newIndex = index - r;
-					if (!left && newIndex >= 0 && newIndex % _mapWidth != _mapWidth - 1)
-						left = FillBombRangeInfo(newIndex, bomb, _map);
-
-					newIndex = index + r * _mapWidth;
-					if (!down && newIndex < _mapSize)
-						down = FillBombRangeInfo(newIndex, bomb, _map);
-
-					newIndex = index - r * _mapWidth;
-					if (!up && newIndex >= 0)
-						up = FillBombRangeInfo(newIndex, bomb, _map);
-				}
+				AddBomb(_state, owner, ComputeIndex(x, y, _mapWidth), param1, param2);
+				_map[ComputeIndex(x, y, _mapWidth)] = -3;
 			}
 			else if (entityType == 2) //item
 			{
 				_items.push_back(Item(x, y, param1));
+				_state.tiles[ComputeIndex(x, y, _mapWidth)] = (param1 == 1) ? TILE_ITEM_RANGE : TILE_ITEM_BOMB;
 
 				switch (param1)
 				{
@@ -424,119 +1263,127 @@ int main()
 			}
 		}
 
+		double _deadline = ComputeTime() + (_rayTablesBuilt ? TURN_TIME : FIRST_TURN_TIME);
+
+		if (!_rayTablesBuilt)
+		{
+			BuildRayTables(_state.tiles, _mapWidth, _mapSize, _rayTables);
+			_rayTablesBuilt = true;
+		}
+
+		ResolveExplosions(_state, _rayTables, _explosions);
+		FillBlastTurns(_explosions, _mapSize, _map);
+
 		//***************************************************************
 		//***************************************************************
 		//decision-making
 
 		string command;
 		int dX, dY;
+		int currentPosIndex = ComputeIndex(_player.x, _player.y, _mapWidth);
 
-		if (_player.numAvailBombs < 1 && (_extraBombItemAvailable || _extraRangeItemAvailable))
+		if (BEAM_SEARCH_ENABLED && SearchPlan(_state, _rayTables, _myId, _deadline, _beam, _children, _plan))
 		{
-			command = "MOVE";
+			int action = _plan[0];
+			int direction = action % MOVE_COUNT;
+			int nextPosIndex = (direction == WAIT_ACTION) ? currentPosIndex : _rayTables.tiles[currentPosIndex][direction][0];
 
-			if (_extraRangeItemAvailable && _player.explosionRange < 6)
-			{
-				ComputeNearestItemPos(1, _items, _player, _map, _mapWidth, _mapSize, dX, dY);
-			}
-			else if (_extraBombItemAvailable)
-			{
-				ComputeNearestItemPos(2, _items, _player, _map, _mapWidth, _mapSize, dX, dY);
-			}
-			else if (_extraRangeItemAvailable)
-			{
-				ComputeNearestItemPos(1, _items, _player, _map, _mapWidth, _mapSize, dX, dY);
-			}
+			command = (action >= MOVE_COUNT) ? "BOMB" : "MOVE";
+			ComputePos(nextPosIndex, _mapWidth, dX, dY);
+			_plan.erase(_plan.begin());
 		}
 		else
 		{
-			EvaluateBombPositions(_mapWidth, _mapSize, _map, _player, _bestTileIndex, _secondTileIndex, _bestTilePriority,
-					_secondTilePriority);
-
-			int bX, bY;
-			ComputePos(_bestTileIndex, _mapWidth, bX, bY);
+			// the tiles the player can walk to are searched once and shared by the evaluations
+			ComputeReachableTiles(_player.x, _player.y, _map, _mapWidth, _mapSize, _reachableTiles);
 
-			if (bX == _player.x && bY == _player.y)
+			if (_player.numAvailBombs < 1 && (_extraBombItemAvailable || _extraRangeItemAvailable))
 			{
-				if (_player.numAvailBombs == 0)
+				command = "MOVE";
+
+				if (_extraRangeItemAvailable && _player.explosionRange < 6)
 				{
-					command = "BOMB";
-					dX = bX;
-					dY = bY;
+					ComputeNearestItemPos(1, _items, _reachableTiles, _mapWidth, dX, dY);
 				}
-				else
+				else if (_extraBombItemAvailable)
 				{
-					//TODO: reevaluate map
-					int sX, sY;
-					ComputePos(_secondTileIndex, _mapWidth, sX, sY);
-
-					command = "BOMB";
-					dX = sX;
-					dY = sY;
+					ComputeNearestItemPos(2, _items, _reachableTiles, _mapWidth, dX, dY);
+				}
+				else if (_extraRangeItemAvailable)
+				{
+					ComputeNearestItemPos(1, _items, _reachableTiles, _mapWidth, dX, dY);
 				}
 			}
 			else
 			{
-				command = "MOVE";
+				EvaluateBombPositions(_mapWidth, _mapSize, _map, _player, _reachableTiles, _state, _rayTables, _bestTileIndex,
+						_secondTileIndex, _bestTilePriority, _secondTilePriority);
+
+				int bX, bY;
+				ComputePos(_bestTileIndex, _mapWidth, bX, bY);
 
-				if (_bestTileIndex > 0)
+				if (bX == _player.x && bY == _player.y)
 				{
-					dX = bX;
-					dY = bY;
+					if (_player.numAvailBombs == 0)
+					{
+						command = "BOMB";
+						dX = bX;
+						dY = bY;
+					}
+					else
+					{
+						//TODO: reevaluate map
+						int sX, sY;
+						ComputePos(_secondTileIndex, _mapWidth, sX, sY);
+
+						command = "BOMB";
+						dX = sX;
+						dY = sY;
+					}
 				}
 				else
 				{
-					dX = _player.x;
-					dY = _player.y;
+					command = "MOVE";
+
+					if (_bestTileIndex > 0)
+					{
+						dX = bX;
+						dY = bY;
+					}
+					else
+					{
+						dX = _player.x;
+						dY = _player.y;
+					}
 				}
 			}
-		}
-
-		//****
 
-		//TODO: replace this by proper pathfinding
+			//****
 
-		int currentPosIndex = ComputeIndex(_player.x, _player.y, _mapWidth);
-		int destinationPosIndex = ComputeIndex(dX, dY, _mapWidth);
-
-		if (_map[destinationPosIndex] == 1)
-		{
-			if (_map[currentPosIndex] != 1)
-			{
-				dX = _player.x;
-				dY = _player.y;
-			}
-			else
+			// the bomb placed now is on the way out too
+			if (command == "BOMB")
 			{
-				int newIndexRight = currentPosIndex + 1;
-				int newIndexLeft = currentPosIndex - 1;
-				int newIndexDown = currentPosIndex + _mapWidth;
-				int newIndexUp = currentPosIndex - _mapWidth;
+				GameState bombedState;
+				memcpy(&bombedState, &_state, sizeof(GameState));
+				AddBomb(bombedState, _myId, currentPosIndex, MAX_BOMB_TIMER, _player.explosionRange);
 
-				if (newIndexRight < _mapSize && newIndexRight % _mapWidth != 0 && newIndexRight != destinationPosIndex
-						&& _map[newIndexRight] >= 0 && _map[newIndexRight] != 1)
-				{
-					dX = _player.x + 1;
-					dY = _player.y;
-				}
-				else if (newIndexLeft >= 0 && newIndexLeft % _mapWidth != _mapWidth - 1 && newIndexLeft != destinationPosIndex
-						&& _map[newIndexLeft] >= 0 && _map[newIndexLeft] != 1)
-				{
-					dX = _player.x - 1;
-					dY = _player.y;
-				}
-				else if (newIndexDown < _mapSize && newIndexDown != destinationPosIndex && _map[newIndexDown] >= 0
-						&& _map[newIndexDown] != 1)
-				{
-					dX = _player.x;
-					dY = _player.y + 1;
-				}
-				else if (newIndexUp >= 0 && newIndexUp != destinationPosIndex && _map[newIndexUp] >= 0 && _map[newIndexUp] != 1)
-				{
-					dX = _player.x;
-					dY = _player.y - 1;
-				}
+				ResolveExplosions(bombedState, _rayTables, _explosions);
+				FillBlastTurns(_explosions, _mapSize, _map);
+				_map[currentPosIndex] = -3;
 			}
+
+			// the first step of the shortest route that is never in a blast when it goes off, to somewhere safe if there is none
+			int destinationPosIndex = (dX >= 0 && dY >= 0) ? ComputeIndex(dX, dY, _mapWidth) : ANY_SAFE_TILE;
+			int nextPosIndex = ComputeFirstStep(currentPosIndex, destinationPosIndex, _map, _explosions.blastTurns, _mapWidth,
+					_mapSize);
+
+			if (nextPosIndex < 0)
+				nextPosIndex = ComputeFirstStep(currentPosIndex, ANY_SAFE_TILE, _map, _explosions.blastTurns, _mapWidth, _mapSize);
+
+			if (nextPosIndex < 0)
+				nextPosIndex = currentPosIndex;
+
+			ComputePos(nextPosIndex, _mapWidth, dX, dY);
 		}
 
 		//****
@@ -551,9 +1398,11 @@ int main()
 			_map[i] = 0;
 		}
 
+		_state = GameState();
 		_items.clear();
 
 		_extraBombItemAvailable = _extraRangeItemAvailable = false;
 		_bestTileIndex = _bestTilePriority = _secondTileIndex = _secondTilePriority = -1;
 	}
 }
+#endif
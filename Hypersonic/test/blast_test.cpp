@@ -0,0 +1,69 @@
+/*
+ * blast_test.cpp
+ *
+ * Two bombs that do not reach each other cover the same tile on different turns: the timed pathfinding has to keep away
+ * from both blasts, not only the first one.
+ *
+ * build: g++ -std=c++11 -O2 -o blast_test blast_test.cpp
+ */
+
+#include <cassert>
+
+#define HYPERSONIC_TEST
+#include "../source/hypersonic.cpp"
+
+const int MAP_WIDTH = 13;
+const int MAP_HEIGHT = 11;
+
+int main()
+{
+	GameState state;
+	int map[MAX_MAP_SIZE];
+	RayTables rays;
+	Explosions explosions;
+
+	// a row of floor on top, boxes everywhere else: the player stays in the row until a way down is opened
+	for (int y = 0; y < MAP_HEIGHT; y++)
+	{
+		for (int x = 0; x < MAP_WIDTH; x++)
+		{
+			int index = ComputeIndex(x, y, MAP_WIDTH);
+			bool wall = x % 2 == 1 && y % 2 == 1;
+
+			state.tiles[index] = wall ? TILE_WALL : ((y == 0) ? TILE_FLOOR : TILE_BOX);
+			map[index] = wall ? -4 : ((y == 0) ? 0 : -1);
+		}
+	}
+
+	BuildRayTables(state.tiles, MAP_WIDTH, MAX_MAP_SIZE, rays);
+
+	// (2,0) is in the blast of the bomb at (1,0) on turn 3 and of the one at (4,0) on turn 7, (3,0) only in the second
+	AddBomb(state, 1, ComputeIndex(1, 0, MAP_WIDTH), 3, 2);
+	AddBomb(state, 2, ComputeIndex(4, 0, MAP_WIDTH), 7, 3);
+	map[ComputeIndex(1, 0, MAP_WIDTH)] = -3;
+	map[ComputeIndex(4, 0, MAP_WIDTH)] = -3;
+
+	ResolveExplosions(state, rays, explosions);
+	FillBlastTurns(explosions, MAX_MAP_SIZE, map);
+
+	int start = ComputeIndex(2, 0, MAP_WIDTH);
+	state.players[0] = PlayerState(start, 0, 3);
+
+	assert(explosions.blastTurns[start] == ((1 << 3) | (1 << 7)));
+	assert(explosions.blastTurns[ComputeIndex(3, 0, MAP_WIDTH)] == (1 << 7));
+
+	// staying after the first blast is not safe, and there is nowhere else to go
+	assert(ComputeFirstStep(start, start, map, explosions.blastTurns, MAP_WIDTH, MAX_MAP_SIZE) == -1);
+	assert(ComputeFirstStep(start, ANY_SAFE_TILE, map, explosions.blastTurns, MAP_WIDTH, MAX_MAP_SIZE) == -1);
+	assert(!CanEscape(state, rays, 0));
+
+	int refuge = ComputeIndex(2, 1, MAP_WIDTH);
+	state.tiles[refuge] = TILE_FLOOR;
+	map[refuge] = 0;
+	ResolveExplosions(state, rays, explosions);
+
+	assert(ComputeFirstStep(start, ANY_SAFE_TILE, map, explosions.blastTurns, MAP_WIDTH, MAX_MAP_SIZE) == refuge);
+	assert(CanEscape(state, rays, 0));
+
+	return 0;
+}